@@ -0,0 +1,146 @@
+#include "BitParallelAutomata.h"
+#include "BitUtilities.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void SetStateBit(uint64_t* set, size_t state) {
+	set[state / 64] |= (uint64_t)1 << (state % 64);
+}
+
+void CreateBitParallelAutomata(const NFA* nfa, BitParallelAutomata* automata)
+{
+	size_t state_count = nfa->states.size;
+	size_t word_count = state_count / 64 + 1;
+	size_t class_count = ComputeNFAByteClasses(nfa, automata->byte_classes);
+	automata->state_count = state_count;
+	automata->word_count = word_count;
+	automata->class_count = class_count;
+	automata->terminal_states = calloc(class_count * word_count, sizeof(uint64_t));
+	automata->initial_states = calloc(word_count, sizeof(uint64_t));
+	automata->accepting_states = calloc(word_count, sizeof(uint64_t));
+	automata->current_set = malloc(sizeof(uint64_t) * word_count);
+	automata->next_set = malloc(sizeof(uint64_t) * word_count);
+
+	size_t transition_count = 0;
+	for (size_t state = 0; state < state_count; state++) {
+		const NFAState* nfa_state = GetElement(nfa->states, state);
+		transition_count += nfa_state->transitions.size;
+	}
+	automata->transition_offsets = malloc(sizeof(size_t) * (state_count + 1));
+	automata->transitions = malloc(sizeof(BitParallelTransition) * max(transition_count, 1));
+
+	size_t transition_index = 0;
+	for (size_t state = 0; state < state_count; state++) {
+		const NFAState* nfa_state = GetElement(nfa->states, state);
+		if (nfa_state->accept_label != DENSE_AUTOMATA_NO_LABEL) {
+			SetStateBit(automata->accepting_states, state);
+		}
+
+		automata->transition_offsets[state] = transition_index;
+		for (size_t index = 0; index < nfa_state->transitions.size; index++) {
+			const NFATransition* nfa_transition = GetElement(nfa_state->transitions, index);
+			BitParallelTransition* transition = automata->transitions + transition_index++;
+			transition->first_class = automata->byte_classes[nfa_transition->first_terminal];
+			transition->last_class = automata->byte_classes[nfa_transition->last_terminal];
+			transition->target_state = (unsigned int)nfa_transition->target_state;
+			for (size_t class_index = transition->first_class; class_index <= transition->last_class; class_index++) {
+				SetStateBit(automata->terminal_states + class_index * word_count, state);
+			}
+		}
+	}
+	automata->transition_offsets[state_count] = transition_index;
+
+	for (size_t index = 0; index < nfa->initial_states.size; index++) {
+		SetStateBit(automata->initial_states, *(size_t*)GetElement(nfa->initial_states, index));
+	}
+}
+
+bool BitParallelAutomataStep(const BitParallelAutomata* automata, const uint64_t* current, unsigned char terminal, uint64_t* next)
+{
+	size_t word_count = automata->word_count;
+	size_t class_index = automata->byte_classes[terminal];
+	const uint64_t* terminal_states = automata->terminal_states + class_index * word_count;
+	memset(next, 0, sizeof(uint64_t) * word_count);
+
+	bool any_active = false;
+	for (size_t word_index = 0; word_index < word_count; word_index++) {
+		// Only the active states that can move on this terminal contribute
+		uint64_t active = current[word_index] & terminal_states[word_index];
+		while (active != 0) {
+			size_t state = word_index * 64 + LowestSetBit(active);
+			active &= active - 1;
+
+			const BitParallelTransition* transition = automata->transitions + automata->transition_offsets[state];
+			const BitParallelTransition* last_transition = automata->transitions + automata->transition_offsets[state + 1];
+			for (; transition < last_transition; transition++) {
+				if (transition->first_class <= class_index && class_index <= transition->last_class) {
+					SetStateBit(next, transition->target_state);
+				}
+			}
+			any_active = true;
+		}
+	}
+	return any_active;
+}
+
+bool BitParallelAutomataIsAccepting(const BitParallelAutomata* automata, const uint64_t* states)
+{
+	for (size_t word_index = 0; word_index < automata->word_count; word_index++) {
+		if (states[word_index] & automata->accepting_states[word_index]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BitParallelAutomataAccepts(BitParallelAutomata* automata, string sequence)
+{
+	uint64_t* current = automata->current_set;
+	uint64_t* next = automata->next_set;
+	memcpy(current, automata->initial_states, sizeof(uint64_t) * automata->word_count);
+
+	for (size_t index = 0; index < sequence.size; index++) {
+		if (!BitParallelAutomataStep(automata, current, sequence.characters[index], next)) {
+			return false;
+		}
+		uint64_t* temporary = current;
+		current = next;
+		next = temporary;
+	}
+	return BitParallelAutomataIsAccepting(automata, current);
+}
+
+size_t BitParallelAutomataLongestMatch(BitParallelAutomata* automata, string sequence)
+{
+	uint64_t* current = automata->current_set;
+	uint64_t* next = automata->next_set;
+	memcpy(current, automata->initial_states, sizeof(uint64_t) * automata->word_count);
+
+	size_t longest_match = BitParallelAutomataIsAccepting(automata, current) ? 0 : DENSE_AUTOMATA_NO_MATCH;
+	for (size_t index = 0; index < sequence.size; index++) {
+		if (!BitParallelAutomataStep(automata, current, sequence.characters[index], next)) {
+			break;
+		}
+		uint64_t* temporary = current;
+		current = next;
+		next = temporary;
+		if (BitParallelAutomataIsAccepting(automata, current)) {
+			longest_match = index + 1;
+		}
+	}
+	return longest_match;
+}
+
+void DestroyBitParallelAutomata(BitParallelAutomata* automata)
+{
+	if (automata->transition_offsets != NULL) {
+		free(automata->transition_offsets);
+		free(automata->transitions);
+		free(automata->terminal_states);
+		free(automata->initial_states);
+		free(automata->accepting_states);
+		free(automata->current_set);
+		free(automata->next_set);
+	}
+	memset(automata, 0, sizeof(*automata));
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "DenseAutomata.h"
+
+/*
+	A transition of the nondeterministic automata over a range of byte classes
+*/
+typedef struct {
+	unsigned char first_class;
+	unsigned char last_class;
+	unsigned int target_state;
+} BitParallelTransition;
+
+/*
+	Simulates a nondeterministic automata directly by keeping the set of active states as a bitset of 64 bit words.
+	Every state keeps the list of its transitions and a step sets the bits of their targets, for the active states
+	that have a transition on the byte class. The memory is linear in the number of transitions, plus one state set
+	per byte class, regardless of how big the deterministic automata would be.
+	BitParallelAutomataAccepts and BitParallelAutomataLongestMatch run in the state sets of the automata, a single
+	automata must not run them from multiple threads at the same time. BitParallelAutomataStep only reads it
+*/
+typedef struct {
+	size_t state_count;
+	// The number of 64 bit words in a state set
+	size_t word_count;
+	// The transitions of a state are the ones from its offset up to the offset of the next state,
+	// there are state_count + 1 offsets
+	size_t* transition_offsets;
+	BitParallelTransition* transitions;
+	// For each byte class, the set of states that have at least one transition on it
+	uint64_t* terminal_states;
+	uint64_t* initial_states;
+	uint64_t* accepting_states;
+	// The state sets that BitParallelAutomataAccepts and BitParallelAutomataLongestMatch run in
+	uint64_t* current_set;
+	uint64_t* next_set;
+	// The byte ranges that no transition crosses, as computed by ComputeNFAByteClasses
+	size_t class_count;
+	unsigned char byte_classes[DENSE_AUTOMATA_ALPHABET_SIZE];
+} BitParallelAutomata;
+
+/*
+	The states with an accept label are the accepting ones
+*/
+void CreateBitParallelAutomata(const NFA* nfa, BitParallelAutomata* automata);
+
+/*
+	Returns true if any path over the sequence ends in an accepting state
+*/
+bool BitParallelAutomataAccepts(BitParallelAutomata* automata, string sequence);
+
+/*
+	Returns the length of the longest prefix of the sequence that is accepted or DENSE_AUTOMATA_NO_MATCH
+*/
+size_t BitParallelAutomataLongestMatch(BitParallelAutomata* automata, string sequence);
+
+/*
+	Computes the state set after a transition on the terminal. The sets have word_count words and must not overlap.
+	Returns false if the next set is empty
+*/
+bool BitParallelAutomataStep(const BitParallelAutomata* automata, const uint64_t* current, unsigned char terminal, uint64_t* next);
+
+bool BitParallelAutomataIsAccepting(const BitParallelAutomata* automata, const uint64_t* states);
+
+void DestroyBitParallelAutomata(BitParallelAutomata* automata);
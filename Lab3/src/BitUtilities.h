@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+	The index of the lowest set bit of a word that is not 0
+*/
+static inline size_t LowestSetBit(uint64_t word) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return index;
+#elif defined(_MSC_VER)
+	// The 64 bit scan does not exist on 32 bit targets, the word is scanned in two halves
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)word)) {
+		return index;
+	}
+	_BitScanForward(&index, (unsigned long)(word >> 32));
+	return index + 32;
+#else
+	return (size_t)__builtin_ctzll(word);
+#endif
+}
@@ -0,0 +1,199 @@
+#include "ConcurrentSymbolTable.h"
+#include "SymbolTable.h"
+#include "TypedHashTable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+static inline int ConcurrentSymbolCompare(const SymbolKey* first, const SymbolKey* second) {
+	return SymbolKeyEqual(first, second);
+}
+
+static inline size_t ConcurrentSymbolHash(const SymbolKey* key) {
+	return SymbolTableHash(SymbolKeyString(key));
+}
+
+static inline size_t ConcurrentSymbolMap(size_t hash, size_t capacity) {
+	return hash & (capacity - 1);
+}
+
+HASH_TABLE_TYPED(ConcurrentSymbolStorage, SymbolKey, size_t, ConcurrentSymbolHash, ConcurrentSymbolCompare, ConcurrentSymbolMap)
+
+#ifdef _WIN32
+
+static void CreateStripeLock(ConcurrentSymbolStripe* stripe) {
+	InitializeSRWLock((PSRWLOCK)&stripe->lock);
+}
+
+// A SRWLOCK needs no cleanup
+static void DestroyStripeLock(ConcurrentSymbolStripe* stripe) {}
+
+static void LockStripeShared(ConcurrentSymbolStripe* stripe) {
+	AcquireSRWLockShared((PSRWLOCK)&stripe->lock);
+}
+
+static void UnlockStripeShared(ConcurrentSymbolStripe* stripe) {
+	ReleaseSRWLockShared((PSRWLOCK)&stripe->lock);
+}
+
+static void LockStripe(ConcurrentSymbolStripe* stripe) {
+	AcquireSRWLockExclusive((PSRWLOCK)&stripe->lock);
+}
+
+static void UnlockStripe(ConcurrentSymbolStripe* stripe) {
+	ReleaseSRWLockExclusive((PSRWLOCK)&stripe->lock);
+}
+
+// Returns the value before the increment
+static size_t IncrementEntryCount(volatile size_t* entry_count) {
+#ifdef _WIN64
+	return (size_t)InterlockedExchangeAdd64((volatile LONG64*)entry_count, 1);
+#else
+	return (size_t)InterlockedExchangeAdd((volatile LONG*)entry_count, 1);
+#endif
+}
+
+#else
+
+static void CreateStripeLock(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_init(&stripe->lock, NULL);
+}
+
+static void DestroyStripeLock(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_destroy(&stripe->lock);
+}
+
+static void LockStripeShared(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_rdlock(&stripe->lock);
+}
+
+static void UnlockStripeShared(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_unlock(&stripe->lock);
+}
+
+static void LockStripe(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_wrlock(&stripe->lock);
+}
+
+static void UnlockStripe(ConcurrentSymbolStripe* stripe) {
+	pthread_rwlock_unlock(&stripe->lock);
+}
+
+// Returns the value before the increment
+static size_t IncrementEntryCount(volatile size_t* entry_count) {
+	return __atomic_fetch_add(entry_count, 1, __ATOMIC_RELAXED);
+}
+
+#endif
+
+/*
+	The stripe is chosen with the high bits of the hash, the tables of the stripes map the tokens with the low bits
+*/
+static ConcurrentSymbolStripe* GetTokenStripe(const ConcurrentSymbolTable* table, size_t hash) {
+	return table->stripes + (hash >> (sizeof(size_t) * 8 - CONCURRENT_SYMBOL_TABLE_STRIPE_BITS));
+}
+
+ConcurrentSymbolTable CreateConcurrentSymbolTable(size_t initial_capacity)
+{
+	ConcurrentSymbolTable result;
+	result.stripes = malloc(sizeof(ConcurrentSymbolStripe) * CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT);
+	result.entry_count = 0;
+	for (size_t index = 0; index < CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT; index++) {
+		ConcurrentSymbolStripe* stripe = result.stripes + index;
+		CreateStripeLock(stripe);
+		stripe->storage = CreateConcurrentSymbolStorage(HashTablePowerOfTwoCapacity(initial_capacity / CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT));
+		// A thread that grows a stripe blocks only the tokens of that stripe, and not for a whole rehash
+		SetTableIncrementalResize(&stripe->storage, SYMBOL_TABLE_RESIZE_STEP);
+		stripe->tokens = CreateStringArena();
+	}
+	return result;
+}
+
+size_t AddOrGetConcurrentSymbolTableEntry(ConcurrentSymbolTable* table, string token)
+{
+	size_t hash = SymbolTableHash(token);
+	ConcurrentSymbolStripe* stripe = GetTokenStripe(table, hash);
+	SymbolKey key = CreateSymbolKey(token);
+
+	// Most of the tokens already exist, their lookups can run at the same time
+	LockStripeShared(stripe);
+	const size_t* existing_entry = FindConcurrentSymbolStoragePtr(&stripe->storage, &key);
+	size_t entry_index = existing_entry != NULL ? *existing_entry : -1;
+	UnlockStripeShared(stripe);
+	if (entry_index != -1) {
+		return entry_index;
+	}
+
+	// Another thread could have added the token in the meantime, the insertion searches for it again
+	LockStripe(stripe);
+	int inserted;
+	size_t index = FindOrInsertConcurrentSymbolStorage(&stripe->storage, &entry_index, &key, &inserted);
+	if (index == -1) {
+		UnlockStripe(stripe);
+		return -1;
+	}
+	size_t* entry = ConcurrentSymbolStorageElementPtr(&stripe->storage, index);
+	if (inserted) {
+		// The index is taken only for an insertion, so the entries have no gaps
+		*entry = IncrementEntryCount(&table->entry_count);
+
+		if (IsSymbolKeyLong(&key)) {
+			// The table was given a view into the caller's token, it must own a copy
+			SymbolKey* stored_key = GetTableIdentifierPtr(&stripe->storage, index);
+			stored_key->long_key.characters = StringArenaCopy(&stripe->tokens, token).characters;
+		}
+	}
+	entry_index = *entry;
+	UnlockStripe(stripe);
+	return entry_index;
+}
+
+size_t GetConcurrentSymbolTableEntry(ConcurrentSymbolTable* table, string token)
+{
+	ConcurrentSymbolStripe* stripe = GetTokenStripe(table, SymbolTableHash(token));
+	SymbolKey key = CreateSymbolKey(token);
+	LockStripeShared(stripe);
+	const size_t* entry = FindConcurrentSymbolStoragePtr(&stripe->storage, &key);
+	size_t entry_index = entry != NULL ? *entry : -1;
+	UnlockStripeShared(stripe);
+	return entry_index;
+}
+
+void DeleteConcurrentSymbolTable(ConcurrentSymbolTable* table)
+{
+	for (size_t index = 0; index < CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT; index++) {
+		ConcurrentSymbolStripe* stripe = table->stripes + index;
+		DestroyTable(&stripe->storage);
+		DestroyStringArena(&stripe->tokens);
+		DestroyStripeLock(stripe);
+	}
+	free(table->stripes);
+	memset(table, 0, sizeof(*table));
+}
+
+static int WriteConcurrentEntryIterate(void* element, void* identifier, void* extra_data) {
+	FILE* file = (FILE*)extra_data;
+	string key = SymbolKeyString((const SymbolKey*)identifier);
+	const size_t* entry_index = (const size_t*)element;
+
+	fprintf(file, "%s | %zu\n", key.characters, *entry_index);
+	return 0;
+}
+
+bool WriteConcurrentSymbolTableToFile(const ConcurrentSymbolTable* table, const char* path)
+{
+	FILE* file = fopen(path, "wt");
+	if (file) {
+		for (size_t index = 0; index < CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT; index++) {
+			IterateTable(&table->stripes[index].storage, WriteConcurrentEntryIterate, file);
+		}
+		fclose(file);
+		return true;
+	}
+	return false;
+}
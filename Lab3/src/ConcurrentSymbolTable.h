@@ -0,0 +1,51 @@
+#pragma once
+#include "HashTable.h"
+#include "StringUtilities.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// The table is split into 2 ^ CONCURRENT_SYMBOL_TABLE_STRIPE_BITS stripes, each with its own lock
+#define CONCURRENT_SYMBOL_TABLE_STRIPE_BITS 6
+#define CONCURRENT_SYMBOL_TABLE_STRIPE_COUNT (1 << CONCURRENT_SYMBOL_TABLE_STRIPE_BITS)
+
+typedef struct {
+	// A SRWLOCK on Windows, a reader writer lock elsewhere. The lookups of tokens that already exist share it
+#ifdef _WIN32
+	void* lock;
+#else
+	pthread_rwlock_t lock;
+#endif
+	HashTable storage;
+	// The copies of the long tokens of the stripe, guarded by its lock
+	StringArena tokens;
+} ConcurrentSymbolStripe;
+
+/*
+	A symbol table that several threads can use at the same time. A token belongs to the stripe given by the high
+	bits of its hash, so the threads wait for each other only when their tokens fall into the same stripe.
+	The entry indices are handed out by an atomic counter of the table, such that they are unique across the stripes
+	and they count from 0 for every table. When several threads add tokens, the order of the entries is the order
+	in which the insertions happened
+*/
+typedef struct {
+	ConcurrentSymbolStripe* stripes;
+	volatile size_t entry_count;
+} ConcurrentSymbolTable;
+
+// The capacity is split between the stripes
+ConcurrentSymbolTable CreateConcurrentSymbolTable(size_t initial_capacity);
+
+// If the token already exists, returns its index, else it adds it and generates a new entry index, -1 if it
+// could not be added like for AddOrGetSymbolTableEntry. Thread safe
+size_t AddOrGetConcurrentSymbolTableEntry(ConcurrentSymbolTable* table, string token);
+
+// Retrieve the entry index for that token, -1 if it does not exist. Thread safe
+size_t GetConcurrentSymbolTableEntry(ConcurrentSymbolTable* table, string token);
+
+// No other thread must use the table anymore
+void DeleteConcurrentSymbolTable(ConcurrentSymbolTable* table);
+
+// The same format as WriteSymbolTableToFile. No other thread must add tokens while it is written
+bool WriteConcurrentSymbolTableToFile(const ConcurrentSymbolTable* table, const char* path);
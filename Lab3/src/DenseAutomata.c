@@ -0,0 +1,724 @@
+#include "DenseAutomata.h"
+#include "HashTable.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	A sorted set of NFA state indices without duplicates. It is the identifier of a deterministic state
+	during the subset construction
+*/
+typedef struct {
+	size_t* states;
+	size_t count;
+} NFAStateSet;
+
+static size_t NFAStateSetHash(const void* identifier) {
+	const NFAStateSet* set = identifier;
+	// FNV-1a over the state indices
+	size_t hash = 14695981039346656037ull;
+	for (size_t index = 0; index < set->count; index++) {
+		hash ^= set->states[index];
+		hash *= 1099511628211ull;
+	}
+	return hash ^ (hash >> 32);
+}
+
+static int NFAStateSetCompare(const void* first, const void* second) {
+	const NFAStateSet* first_set = first;
+	const NFAStateSet* second_set = second;
+	if (first_set->count != second_set->count) {
+		return 0;
+	}
+	return memcmp(first_set->states, second_set->states, sizeof(size_t) * first_set->count) == 0;
+}
+
+static int CompareStateIndices(const void* first, const void* second) {
+	size_t first_index = *(const size_t*)first;
+	size_t second_index = *(const size_t*)second;
+	return first_index < second_index ? -1 : (first_index > second_index ? 1 : 0);
+}
+
+/*
+	Sorts the indices and removes the duplicates. Returns the new count
+*/
+static size_t SortUniqueStateIndices(size_t* states, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+
+	qsort(states, count, sizeof(size_t), CompareStateIndices);
+	size_t unique_count = 1;
+	for (size_t index = 1; index < count; index++) {
+		if (states[index] != states[unique_count - 1]) {
+			states[unique_count++] = states[index];
+		}
+	}
+	return unique_count;
+}
+
+NFA CreateNFA()
+{
+	NFA nfa;
+	nfa.states = CreateStream(0, sizeof(NFAState));
+	nfa.initial_states = CreateStream(0, sizeof(size_t));
+	return nfa;
+}
+
+size_t AddNFAState(NFA* nfa, size_t accept_label)
+{
+	NFAState state;
+	state.transitions = CreateStream(0, sizeof(NFATransition));
+	state.accept_label = accept_label;
+	Add(&nfa->states, &state);
+	return nfa->states.size - 1;
+}
+
+void AddNFAInitialState(NFA* nfa, size_t state)
+{
+	Add(&nfa->initial_states, &state);
+}
+
+void AddNFATransition(NFA* nfa, size_t state, unsigned char first_terminal, unsigned char last_terminal, size_t target_state)
+{
+	NFAState* nfa_state = GetElement(nfa->states, state);
+	NFATransition transition;
+	transition.target_state = target_state;
+	transition.first_terminal = first_terminal;
+	transition.last_terminal = last_terminal;
+	Add(&nfa_state->transitions, &transition);
+}
+
+size_t ComputeNFAByteClasses(const NFA* nfa, unsigned char* byte_classes)
+{
+	// A class starts at every byte where a transition range starts or where one has just ended
+	bool class_starts[DENSE_AUTOMATA_ALPHABET_SIZE + 1];
+	memset(class_starts, 0, sizeof(class_starts));
+	for (size_t state = 0; state < nfa->states.size; state++) {
+		const NFAState* nfa_state = GetElement(nfa->states, state);
+		for (size_t index = 0; index < nfa_state->transitions.size; index++) {
+			const NFATransition* transition = GetElement(nfa_state->transitions, index);
+			class_starts[transition->first_terminal] = true;
+			class_starts[transition->last_terminal + 1] = true;
+		}
+	}
+
+	size_t class_count = 0;
+	for (size_t terminal = 0; terminal < DENSE_AUTOMATA_ALPHABET_SIZE; terminal++) {
+		if (class_starts[terminal] && terminal > 0) {
+			class_count++;
+		}
+		byte_classes[terminal] = (unsigned char)class_count;
+	}
+	return class_count + 1;
+}
+
+static uint64_t DenseColumnHash(const DenseAutomata* dense_automata, size_t class_index) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t state = 0; state < dense_automata->state_count; state++) {
+		hash ^= dense_automata->transitions[state * dense_automata->class_count + class_index];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool DenseColumnsEqual(const DenseAutomata* dense_automata, size_t first_class, size_t second_class) {
+	const unsigned int* transitions = dense_automata->transitions;
+	for (size_t state = 0; state < dense_automata->state_count; state++) {
+		size_t row = state * dense_automata->class_count;
+		if (transitions[row + first_class] != transitions[row + second_class]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+	Merges the classes whose columns are identical in every state, like the lowercase and the uppercase letters
+	of an identifier automata, which end up in different byte ranges. The table is rebuilt with fewer columns
+*/
+static void MergeDenseByteClasses(DenseAutomata* dense_automata) {
+	size_t class_count = dense_automata->class_count;
+	uint64_t column_hashes[DENSE_AUTOMATA_ALPHABET_SIZE];
+	// The merged class of each class and the first original class of each merged class
+	size_t merged_classes[DENSE_AUTOMATA_ALPHABET_SIZE];
+	size_t representatives[DENSE_AUTOMATA_ALPHABET_SIZE];
+	size_t merged_count = 0;
+	for (size_t class_index = 0; class_index < class_count; class_index++) {
+		column_hashes[class_index] = DenseColumnHash(dense_automata, class_index);
+		merged_classes[class_index] = -1;
+		for (size_t merged_index = 0; merged_index < merged_count; merged_index++) {
+			size_t representative = representatives[merged_index];
+			if (column_hashes[representative] == column_hashes[class_index] && DenseColumnsEqual(dense_automata, representative, class_index)) {
+				merged_classes[class_index] = merged_index;
+				break;
+			}
+		}
+		if (merged_classes[class_index] == -1) {
+			merged_classes[class_index] = merged_count;
+			representatives[merged_count++] = class_index;
+		}
+	}
+
+	if (merged_count == class_count) {
+		return;
+	}
+
+	unsigned int* transitions = malloc(sizeof(unsigned int) * merged_count * dense_automata->state_count);
+	for (size_t state = 0; state < dense_automata->state_count; state++) {
+		for (size_t merged_index = 0; merged_index < merged_count; merged_index++) {
+			transitions[state * merged_count + merged_index] = dense_automata->transitions[state * class_count + representatives[merged_index]];
+		}
+	}
+	for (size_t terminal = 0; terminal < DENSE_AUTOMATA_ALPHABET_SIZE; terminal++) {
+		dense_automata->byte_classes[terminal] = (unsigned char)merged_classes[dense_automata->byte_classes[terminal]];
+	}
+	free(dense_automata->transitions);
+	dense_automata->transitions = transitions;
+	dense_automata->class_count = merged_count;
+}
+
+void DestroyNFA(NFA* nfa)
+{
+	for (size_t index = 0; index < nfa->states.size; index++) {
+		NFAState* state = GetElement(nfa->states, index);
+		FreeStream(state->transitions);
+	}
+	FreeStream(nfa->states);
+	FreeStream(nfa->initial_states);
+	memset(nfa, 0, sizeof(*nfa));
+}
+
+bool DeterminizeNFA(const NFA* nfa, size_t max_state_count, DenseAutomata* dense_automata)
+{
+	// Identifier is NFAStateSet, element is the deterministic state index
+	HashTable subsets = CreateTable(
+		64,
+		sizeof(size_t),
+		sizeof(NFAStateSet),
+		HashTableMapPowerOfTwo,
+		NFAStateSetHash,
+		NFAStateSetCompare
+	);
+	// Element type is NFAStateSet, indexed by the deterministic state
+	ResizableStream state_sets = CreateStream(64, sizeof(NFAStateSet));
+	unsigned char byte_classes[DENSE_AUTOMATA_ALPHABET_SIZE];
+	size_t class_count = ComputeNFAByteClasses(nfa, byte_classes);
+	// Element type is a row of class_count unsigned ints
+	ResizableStream rows = CreateStream(64, sizeof(unsigned int) * class_count);
+	// Element type is size_t
+	ResizableStream accept_labels = CreateStream(64, sizeof(size_t));
+
+	// The empty set is the dead state
+	NFAStateSet dead_set = { NULL, 0 };
+	Add(&state_sets, &dead_set);
+
+	NFAStateSet initial_set;
+	initial_set.states = malloc(sizeof(size_t) * (nfa->initial_states.size + 1));
+	memcpy(initial_set.states, nfa->initial_states.buffer, sizeof(size_t) * nfa->initial_states.size);
+	initial_set.count = SortUniqueStateIndices(initial_set.states, nfa->initial_states.size);
+	Add(&state_sets, &initial_set);
+	size_t initial_index = 1;
+	AddTable(&subsets, &initial_index, &initial_set);
+
+	// The targets of the current set for each byte class. Element type is size_t
+	ResizableStream buckets[DENSE_AUTOMATA_ALPHABET_SIZE];
+	for (size_t index = 0; index < class_count; index++) {
+		buckets[index] = CreateStream(0, sizeof(size_t));
+	}
+
+	bool success = true;
+	unsigned int row[DENSE_AUTOMATA_ALPHABET_SIZE];
+	for (size_t state_index = 0; state_index < state_sets.size; state_index++) {
+		NFAStateSet current_set = *(NFAStateSet*)GetElement(state_sets, state_index);
+
+		size_t accept_label = DENSE_AUTOMATA_NO_LABEL;
+		for (size_t member_index = 0; member_index < current_set.count; member_index++) {
+			const NFAState* nfa_state = GetElement(nfa->states, current_set.states[member_index]);
+			accept_label = min(accept_label, nfa_state->accept_label);
+			for (size_t transition_index = 0; transition_index < nfa_state->transitions.size; transition_index++) {
+				const NFATransition* transition = GetElement(nfa_state->transitions, transition_index);
+				// The classes of a range are consecutive, since no range crosses a class boundary
+				size_t last_class = byte_classes[transition->last_terminal];
+				for (size_t class_index = byte_classes[transition->first_terminal]; class_index <= last_class; class_index++) {
+					Add(&buckets[class_index], &transition->target_state);
+				}
+			}
+		}
+		Add(&accept_labels, &accept_label);
+
+		for (size_t class_index = 0; class_index < class_count; class_index++) {
+			ResizableStream* bucket = &buckets[class_index];
+			if (bucket->size == 0) {
+				row[class_index] = DENSE_AUTOMATA_DEAD_STATE;
+				continue;
+			}
+
+			NFAStateSet target_set;
+			target_set.states = bucket->buffer;
+			target_set.count = SortUniqueStateIndices(bucket->buffer, bucket->size);
+			bucket->size = 0;
+
+			const size_t* existing_index = FindTablePtr(&subsets, &target_set);
+			if (existing_index != NULL) {
+				row[class_index] = (unsigned int)*existing_index;
+			}
+			else {
+				if (state_sets.size >= min(max_state_count, DENSE_AUTOMATA_UNLIMITED_STATES)) {
+					success = false;
+					break;
+				}
+
+				size_t new_index = state_sets.size;
+				NFAStateSet stable_set;
+				stable_set.states = malloc(sizeof(size_t) * target_set.count);
+				memcpy(stable_set.states, target_set.states, sizeof(size_t) * target_set.count);
+				stable_set.count = target_set.count;
+				Add(&state_sets, &stable_set);
+
+				AddTable(&subsets, &new_index, &stable_set);
+				row[class_index] = (unsigned int)new_index;
+			}
+		}
+
+		if (!success) {
+			break;
+		}
+		Add(&rows, row);
+	}
+
+	for (size_t index = 0; index < class_count; index++) {
+		FreeStream(buckets[index]);
+	}
+	for (size_t index = 0; index < state_sets.size; index++) {
+		NFAStateSet* set = GetElement(state_sets, index);
+		if (set->states != NULL) {
+			free(set->states);
+		}
+	}
+	FreeStream(state_sets);
+	DestroyTable(&subsets);
+
+	if (!success) {
+		FreeStream(rows);
+		FreeStream(accept_labels);
+		return false;
+	}
+
+	size_t* labels = accept_labels.buffer;
+	uint64_t* accepting_states = calloc(rows.size / 64 + 1, sizeof(uint64_t));
+	for (size_t index = 0; index < rows.size; index++) {
+		if (labels[index] != DENSE_AUTOMATA_NO_LABEL) {
+			accepting_states[index / 64] |= (uint64_t)1 << (index % 64);
+		}
+	}
+
+	dense_automata->transitions = rows.buffer;
+	dense_automata->accept_labels = labels;
+	dense_automata->accepting_states = accepting_states;
+	dense_automata->state_count = rows.size;
+	dense_automata->initial_state = (unsigned int)initial_index;
+	dense_automata->class_count = class_count;
+	memcpy(dense_automata->byte_classes, byte_classes, sizeof(byte_classes));
+	MergeDenseByteClasses(dense_automata);
+	return true;
+}
+
+typedef struct {
+	size_t label;
+	size_t state;
+} LabeledState;
+
+static int CompareLabeledStates(const void* first, const void* second) {
+	const LabeledState* first_state = first;
+	const LabeledState* second_state = second;
+	if (first_state->label != second_state->label) {
+		return first_state->label < second_state->label ? -1 : 1;
+	}
+	return first_state->state < second_state->state ? -1 : (first_state->state > second_state->state ? 1 : 0);
+}
+
+/*
+	The states are kept in an array ordered by block, every block is a contiguous range of it.
+	Splitting a block moves its marked states to the front of the range
+*/
+typedef struct {
+	size_t* elements;
+	size_t* locations;
+	size_t* state_blocks;
+	size_t* block_starts;
+	size_t* block_ends;
+	size_t* block_marked_counts;
+	bool* block_in_worklist;
+	size_t block_count;
+} HopcroftPartition;
+
+static size_t AddHopcroftBlock(HopcroftPartition* partition, size_t start, size_t end) {
+	size_t block = partition->block_count++;
+	partition->block_starts[block] = start;
+	partition->block_ends[block] = end;
+	partition->block_marked_counts[block] = 0;
+	partition->block_in_worklist[block] = false;
+	for (size_t index = start; index < end; index++) {
+		partition->state_blocks[partition->elements[index]] = block;
+	}
+	return block;
+}
+
+void MinimizeDenseAutomata(const DenseAutomata* dense_automata, DenseAutomata* minimized_automata)
+{
+	size_t state_count = dense_automata->state_count;
+	size_t class_count = dense_automata->class_count;
+	const unsigned int* transitions = dense_automata->transitions;
+
+	// The predecessors of each state for each byte class, grouped by class and then by target state
+	size_t* predecessor_starts = calloc(class_count * (state_count + 1), sizeof(size_t));
+	size_t* predecessors = malloc(sizeof(size_t) * class_count * state_count);
+	for (size_t class_index = 0; class_index < class_count; class_index++) {
+		size_t* starts = predecessor_starts + class_index * (state_count + 1);
+		for (size_t state = 0; state < state_count; state++) {
+			starts[transitions[state * class_count + class_index] + 1]++;
+		}
+		for (size_t state = 0; state < state_count; state++) {
+			starts[state + 1] += starts[state];
+		}
+		size_t* class_predecessors = predecessors + class_index * state_count;
+		for (size_t state = 0; state < state_count; state++) {
+			size_t target = transitions[state * class_count + class_index];
+			// The start is used as a fill counter and restored below
+			class_predecessors[starts[target]++] = state;
+		}
+		for (size_t state = state_count; state > 0; state--) {
+			starts[state] = starts[state - 1];
+		}
+		starts[0] = 0;
+	}
+
+	HopcroftPartition partition;
+	partition.elements = malloc(sizeof(size_t) * state_count);
+	partition.locations = malloc(sizeof(size_t) * state_count);
+	partition.state_blocks = malloc(sizeof(size_t) * state_count);
+	partition.block_starts = malloc(sizeof(size_t) * state_count);
+	partition.block_ends = malloc(sizeof(size_t) * state_count);
+	partition.block_marked_counts = malloc(sizeof(size_t) * state_count);
+	partition.block_in_worklist = malloc(sizeof(bool) * state_count);
+	partition.block_count = 0;
+
+	// The initial partition groups the states with the same accept label
+	LabeledState* labeled_states = malloc(sizeof(LabeledState) * state_count);
+	for (size_t state = 0; state < state_count; state++) {
+		labeled_states[state].label = dense_automata->accept_labels[state];
+		labeled_states[state].state = state;
+	}
+	qsort(labeled_states, state_count, sizeof(LabeledState), CompareLabeledStates);
+	for (size_t index = 0; index < state_count; index++) {
+		partition.elements[index] = labeled_states[index].state;
+		partition.locations[labeled_states[index].state] = index;
+	}
+	free(labeled_states);
+
+	// Element type is size_t, the blocks waiting to be used as splitters
+	ResizableStream worklist = CreateStream(16, sizeof(size_t));
+	size_t block_start = 0;
+	for (size_t index = 1; index <= state_count; index++) {
+		if (index == state_count || dense_automata->accept_labels[partition.elements[index]] != dense_automata->accept_labels[partition.elements[block_start]]) {
+			size_t block = AddHopcroftBlock(&partition, block_start, index);
+			partition.block_in_worklist[block] = true;
+			Add(&worklist, &block);
+			block_start = index;
+		}
+	}
+
+	bool* marked_states = calloc(state_count, sizeof(bool));
+	size_t* splitter = malloc(sizeof(size_t) * state_count);
+	// Element type is size_t
+	ResizableStream marked_list = CreateStream(16, sizeof(size_t));
+	ResizableStream touched_blocks = CreateStream(16, sizeof(size_t));
+
+	while (worklist.size > 0) {
+		worklist.size--;
+		size_t splitter_block = *(size_t*)GetElement(worklist, worklist.size);
+		partition.block_in_worklist[splitter_block] = false;
+
+		// The splitter can be split while it is being used, a copy of its states is needed
+		size_t splitter_size = partition.block_ends[splitter_block] - partition.block_starts[splitter_block];
+		memcpy(splitter, partition.elements + partition.block_starts[splitter_block], sizeof(size_t) * splitter_size);
+
+		for (size_t class_index = 0; class_index < class_count; class_index++) {
+			const size_t* starts = predecessor_starts + class_index * (state_count + 1);
+			const size_t* class_predecessors = predecessors + class_index * state_count;
+
+			for (size_t splitter_index = 0; splitter_index < splitter_size; splitter_index++) {
+				size_t target = splitter[splitter_index];
+				for (size_t predecessor_index = starts[target]; predecessor_index < starts[target + 1]; predecessor_index++) {
+					size_t state = class_predecessors[predecessor_index];
+					if (marked_states[state]) {
+						continue;
+					}
+					marked_states[state] = true;
+					Add(&marked_list, &state);
+
+					// Swap the state into the marked front part of its block
+					size_t block = partition.state_blocks[state];
+					size_t marked_location = partition.block_starts[block] + partition.block_marked_counts[block];
+					size_t swapped_state = partition.elements[marked_location];
+					size_t state_location = partition.locations[state];
+					partition.elements[marked_location] = state;
+					partition.elements[state_location] = swapped_state;
+					partition.locations[state] = marked_location;
+					partition.locations[swapped_state] = state_location;
+					if (partition.block_marked_counts[block]++ == 0) {
+						Add(&touched_blocks, &block);
+					}
+				}
+			}
+
+			for (size_t touched_index = 0; touched_index < touched_blocks.size; touched_index++) {
+				size_t block = *(size_t*)GetElement(touched_blocks, touched_index);
+				size_t start = partition.block_starts[block];
+				size_t marked_count = partition.block_marked_counts[block];
+				partition.block_marked_counts[block] = 0;
+				if (marked_count == partition.block_ends[block] - start) {
+					continue;
+				}
+
+				// The marked part becomes a new block
+				size_t new_block = AddHopcroftBlock(&partition, start, start + marked_count);
+				partition.block_starts[block] = start + marked_count;
+				if (partition.block_in_worklist[block]) {
+					partition.block_in_worklist[new_block] = true;
+					Add(&worklist, &new_block);
+				}
+				else {
+					size_t smaller_block = marked_count <= partition.block_ends[block] - partition.block_starts[block] ? new_block : block;
+					partition.block_in_worklist[smaller_block] = true;
+					Add(&worklist, &smaller_block);
+				}
+			}
+			touched_blocks.size = 0;
+
+			for (size_t marked_index = 0; marked_index < marked_list.size; marked_index++) {
+				marked_states[*(size_t*)GetElement(marked_list, marked_index)] = false;
+			}
+			marked_list.size = 0;
+		}
+	}
+
+	// The block of the dead state becomes state 0, the others follow in block order
+	size_t* block_states = malloc(sizeof(size_t) * partition.block_count);
+	size_t dead_block = partition.state_blocks[DENSE_AUTOMATA_DEAD_STATE];
+	size_t next_state = 1;
+	for (size_t block = 0; block < partition.block_count; block++) {
+		block_states[block] = block == dead_block ? DENSE_AUTOMATA_DEAD_STATE : next_state++;
+	}
+
+	minimized_automata->state_count = partition.block_count;
+	minimized_automata->class_count = class_count;
+	memcpy(minimized_automata->byte_classes, dense_automata->byte_classes, sizeof(dense_automata->byte_classes));
+	minimized_automata->transitions = malloc(sizeof(unsigned int) * class_count * partition.block_count);
+	minimized_automata->accept_labels = malloc(sizeof(size_t) * partition.block_count);
+	minimized_automata->accepting_states = calloc(partition.block_count / 64 + 1, sizeof(uint64_t));
+	for (size_t block = 0; block < partition.block_count; block++) {
+		size_t representative = partition.elements[partition.block_starts[block]];
+		size_t new_state = block_states[block];
+		for (size_t class_index = 0; class_index < class_count; class_index++) {
+			size_t target = transitions[representative * class_count + class_index];
+			minimized_automata->transitions[new_state * class_count + class_index] = (unsigned int)block_states[partition.state_blocks[target]];
+		}
+		minimized_automata->accept_labels[new_state] = dense_automata->accept_labels[representative];
+		if (dense_automata->accept_labels[representative] != DENSE_AUTOMATA_NO_LABEL) {
+			minimized_automata->accepting_states[new_state / 64] |= (uint64_t)1 << (new_state % 64);
+		}
+	}
+	minimized_automata->initial_state = (unsigned int)block_states[partition.state_blocks[dense_automata->initial_state]];
+	MergeDenseByteClasses(minimized_automata);
+
+	free(block_states);
+	FreeStream(touched_blocks);
+	FreeStream(marked_list);
+	FreeStream(worklist);
+	free(splitter);
+	free(marked_states);
+	free(partition.elements);
+	free(partition.locations);
+	free(partition.state_blocks);
+	free(partition.block_starts);
+	free(partition.block_ends);
+	free(partition.block_marked_counts);
+	free(partition.block_in_worklist);
+	free(predecessors);
+	free(predecessor_starts);
+}
+
+size_t DenseAutomataRun(const DenseAutomata* dense_automata, string sequence)
+{
+	const unsigned int* transitions = dense_automata->transitions;
+	const unsigned char* byte_classes = dense_automata->byte_classes;
+	size_t class_count = dense_automata->class_count;
+	unsigned int state = dense_automata->initial_state;
+	for (size_t index = 0; index < sequence.size; index++) {
+		state = transitions[(size_t)state * class_count + byte_classes[(unsigned char)sequence.characters[index]]];
+		if (state == DENSE_AUTOMATA_DEAD_STATE) {
+			return DENSE_AUTOMATA_NO_LABEL;
+		}
+	}
+	return dense_automata->accept_labels[state];
+}
+
+bool DenseAutomataAccepts(const DenseAutomata* dense_automata, string sequence)
+{
+	const unsigned int* transitions = dense_automata->transitions;
+	const unsigned char* byte_classes = dense_automata->byte_classes;
+	size_t class_count = dense_automata->class_count;
+	unsigned int state = dense_automata->initial_state;
+	for (size_t index = 0; index < sequence.size && state != DENSE_AUTOMATA_DEAD_STATE; index++) {
+		state = transitions[(size_t)state * class_count + byte_classes[(unsigned char)sequence.characters[index]]];
+	}
+	return (dense_automata->accepting_states[state / 64] >> (state % 64)) & 1;
+}
+
+// The most bytes that the lanes of a batch advance before the stuck lanes are replaced
+#define DENSE_AUTOMATA_BATCH_ROUND 16
+
+// The shorter sequences are not worth a lane
+#define DENSE_AUTOMATA_BATCH_MIN_LANE_SIZE 32
+
+// The sequence index of a lane that has nothing left to run
+#define DENSE_AUTOMATA_BATCH_IDLE ((size_t)-1)
+
+/*
+	Verifies directly the short sequences starting at next_sequence, the processor already overlaps them well
+	on its own, and returns the index of the first one that is long enough for a lane or the count
+*/
+static size_t DenseBatchNextLongSequence(const DenseAutomata* dense_automata, const string* sequences, size_t count, size_t next_sequence, uint64_t* results) {
+	while (next_sequence < count && sequences[next_sequence].size < DENSE_AUTOMATA_BATCH_MIN_LANE_SIZE) {
+		if (DenseAutomataAccepts(dense_automata, sequences[next_sequence])) {
+			results[next_sequence / 64] |= (uint64_t)1 << (next_sequence % 64);
+		}
+		next_sequence++;
+	}
+	return next_sequence;
+}
+
+void DenseAutomataAcceptsBatch(const DenseAutomata* dense_automata, const string* sequences, size_t count, uint64_t* results)
+{
+	memset(results, 0, sizeof(uint64_t) * ((count + 63) / 64));
+
+	const unsigned int* transitions = dense_automata->transitions;
+	const unsigned char* byte_classes = dense_automata->byte_classes;
+	size_t class_count = dense_automata->class_count;
+
+	// The idle lanes keep running in the dead state over these bytes, such that every round has all the lanes
+	static const char idle_characters[DENSE_AUTOMATA_BATCH_ROUND] = { 0 };
+
+	const char* lane_characters[DENSE_AUTOMATA_BATCH_LANES];
+	size_t lane_remaining[DENSE_AUTOMATA_BATCH_LANES];
+	size_t lane_sequences[DENSE_AUTOMATA_BATCH_LANES];
+	unsigned int lane_states[DENSE_AUTOMATA_BATCH_LANES];
+	size_t next_sequence = 0;
+	size_t active_count = 0;
+	for (size_t lane = 0; lane < DENSE_AUTOMATA_BATCH_LANES; lane++) {
+		lane_characters[lane] = idle_characters;
+		lane_remaining[lane] = DENSE_AUTOMATA_BATCH_ROUND;
+		lane_sequences[lane] = DENSE_AUTOMATA_BATCH_IDLE;
+		lane_states[lane] = DENSE_AUTOMATA_DEAD_STATE;
+		next_sequence = DenseBatchNextLongSequence(dense_automata, sequences, count, next_sequence, results);
+		if (next_sequence < count) {
+			lane_characters[lane] = sequences[next_sequence].characters;
+			lane_remaining[lane] = sequences[next_sequence].size;
+			lane_sequences[lane] = next_sequence;
+			lane_states[lane] = dense_automata->initial_state;
+			next_sequence++;
+			active_count++;
+		}
+	}
+
+	while (active_count > 0) {
+		// All the lanes advance together for as long as the shortest one lasts, but at most a round of bytes
+		// such that the lanes that got stuck are replaced soon. The loads of the lanes do not depend on each
+		// other. The dead state absorbs every byte, so it needs no check in here
+		size_t step_count = DENSE_AUTOMATA_BATCH_ROUND;
+		for (size_t lane = 0; lane < DENSE_AUTOMATA_BATCH_LANES; lane++) {
+			step_count = min(step_count, lane_remaining[lane]);
+		}
+		for (size_t step = 0; step < step_count; step++) {
+			for (size_t lane = 0; lane < DENSE_AUTOMATA_BATCH_LANES; lane++) {
+				unsigned char byte_class = byte_classes[(unsigned char)lane_characters[lane][step]];
+				lane_states[lane] = transitions[(size_t)lane_states[lane] * class_count + byte_class];
+			}
+		}
+
+		// The lanes that finished or got stuck take the next sequence or become idle
+		for (size_t lane = 0; lane < DENSE_AUTOMATA_BATCH_LANES; lane++) {
+			if (lane_sequences[lane] == DENSE_AUTOMATA_BATCH_IDLE) {
+				continue;
+			}
+			lane_characters[lane] += step_count;
+			lane_remaining[lane] -= step_count;
+			if (lane_remaining[lane] > 0 && lane_states[lane] != DENSE_AUTOMATA_DEAD_STATE) {
+				continue;
+			}
+
+			if (DenseAutomataIsAccepting(dense_automata, lane_states[lane])) {
+				results[lane_sequences[lane] / 64] |= (uint64_t)1 << (lane_sequences[lane] % 64);
+			}
+			next_sequence = DenseBatchNextLongSequence(dense_automata, sequences, count, next_sequence, results);
+			if (next_sequence < count) {
+				lane_characters[lane] = sequences[next_sequence].characters;
+				lane_remaining[lane] = sequences[next_sequence].size;
+				lane_sequences[lane] = next_sequence;
+				lane_states[lane] = dense_automata->initial_state;
+				next_sequence++;
+			}
+			else {
+				lane_characters[lane] = idle_characters;
+				lane_remaining[lane] = DENSE_AUTOMATA_BATCH_ROUND;
+				lane_sequences[lane] = DENSE_AUTOMATA_BATCH_IDLE;
+				lane_states[lane] = DENSE_AUTOMATA_DEAD_STATE;
+				active_count--;
+			}
+		}
+	}
+}
+
+size_t DenseAutomataLongestMatch(const DenseAutomata* dense_automata, string sequence)
+{
+	const unsigned int* transitions = dense_automata->transitions;
+	const unsigned char* byte_classes = dense_automata->byte_classes;
+	size_t class_count = dense_automata->class_count;
+	unsigned int state = dense_automata->initial_state;
+	size_t longest_match = DenseAutomataIsAccepting(dense_automata, state) ? 0 : DENSE_AUTOMATA_NO_MATCH;
+	for (size_t index = 0; index < sequence.size; index++) {
+		state = transitions[(size_t)state * class_count + byte_classes[(unsigned char)sequence.characters[index]]];
+		if (state == DENSE_AUTOMATA_DEAD_STATE) {
+			break;
+		}
+		if (DenseAutomataIsAccepting(dense_automata, state)) {
+			longest_match = index + 1;
+		}
+	}
+	return longest_match;
+}
+
+unsigned int DenseAutomataStep(const DenseAutomata* dense_automata, unsigned int state, unsigned char terminal)
+{
+	return dense_automata->transitions[(size_t)state * dense_automata->class_count + dense_automata->byte_classes[terminal]];
+}
+
+bool DenseAutomataIsAccepting(const DenseAutomata* dense_automata, unsigned int state)
+{
+	return (dense_automata->accepting_states[state / 64] >> (state % 64)) & 1;
+}
+
+void DestroyDenseAutomata(DenseAutomata* dense_automata)
+{
+	if (dense_automata->transitions != NULL) {
+		free(dense_automata->transitions);
+	}
+	if (dense_automata->accept_labels != NULL) {
+		free(dense_automata->accept_labels);
+	}
+	if (dense_automata->accepting_states != NULL) {
+		free(dense_automata->accepting_states);
+	}
+	memset(dense_automata, 0, sizeof(*dense_automata));
+}
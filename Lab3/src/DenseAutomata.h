@@ -0,0 +1,139 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "ResizableStream.h"
+#include "StringUtilities.h"
+
+/*
+	The transition tables have a column for every byte value
+*/
+#define DENSE_AUTOMATA_ALPHABET_SIZE 256
+
+/*
+	Every transition that is not defined leads into this state and it never leaves it
+*/
+#define DENSE_AUTOMATA_DEAD_STATE 0
+
+/*
+	The accept label of the states that are not accepting
+*/
+#define DENSE_AUTOMATA_NO_LABEL ((size_t)-1)
+
+/*
+	Returned by the longest match functions when not even the empty prefix is accepted
+*/
+#define DENSE_AUTOMATA_NO_MATCH ((size_t)-1)
+
+/*
+	How many sequences the batch verification runs at the same time
+*/
+#define DENSE_AUTOMATA_BATCH_LANES 8
+
+// A transition on every byte in the inclusive range
+typedef struct {
+	size_t target_state;
+	unsigned char first_terminal;
+	unsigned char last_terminal;
+} NFATransition;
+
+typedef struct {
+	// Element type is NFATransition
+	ResizableStream transitions;
+	// DENSE_AUTOMATA_NO_LABEL if the state is not accepting. When several accepting states end up
+	// in the same deterministic state, the smallest label wins
+	size_t accept_label;
+} NFAState;
+
+typedef struct {
+	// Element type is NFAState
+	ResizableStream states;
+	// Element type is size_t. There can be more than one initial state, which makes
+	// the union of several automata trivial
+	ResizableStream initial_states;
+} NFA;
+
+typedef struct {
+	// state_count rows of class_count entries, indexed by the class of the byte value
+	unsigned int* transitions;
+	// Element per state, the accept label or DENSE_AUTOMATA_NO_LABEL
+	size_t* accept_labels;
+	// A bit per state, set if the state has an accept label
+	uint64_t* accepting_states;
+	size_t state_count;
+	unsigned int initial_state;
+	// The bytes that lead into the same state from every state share a class. The tables
+	// have a column for every class instead of one for every byte value
+	size_t class_count;
+	unsigned char byte_classes[DENSE_AUTOMATA_ALPHABET_SIZE];
+} DenseAutomata;
+
+NFA CreateNFA();
+
+// Returns the index of the new state
+size_t AddNFAState(NFA* nfa, size_t accept_label);
+
+void AddNFAInitialState(NFA* nfa, size_t state);
+
+// Adds a transition on every byte from first_terminal up to and including last_terminal
+void AddNFATransition(NFA* nfa, size_t state, unsigned char first_terminal, unsigned char last_terminal, size_t target_state);
+
+/*
+	Splits the byte values into the ranges that no transition of the nfa crosses, the bytes of a range
+	behave the same in every state. Returns the number of classes
+*/
+size_t ComputeNFAByteClasses(const NFA* nfa, unsigned char* byte_classes);
+
+void DestroyNFA(NFA* nfa);
+
+/*
+	No limit for the number of deterministic states other than the table index type
+*/
+#define DENSE_AUTOMATA_UNLIMITED_STATES ((size_t)UINT32_MAX)
+
+/*
+	Builds the deterministic automata with the subset construction. Only the subsets reachable from
+	the initial states are created and the bytes with identical columns are merged into a class.
+	Returns false if more than max_state_count states would be needed
+*/
+bool DeterminizeNFA(const NFA* nfa, size_t max_state_count, DenseAutomata* dense_automata);
+
+/*
+	Builds the minimal automata with Hopcroft's partition refinement. States are equivalent only if they have
+	the same accept label. The dead state stays at index 0 and absorbs the states that can never accept.
+	The byte classes are merged again, since fewer states can distinguish fewer bytes
+*/
+void MinimizeDenseAutomata(const DenseAutomata* dense_automata, DenseAutomata* minimized_automata);
+
+/*
+	Runs the automata over the whole sequence and returns the accept label of the state it stops in.
+	It stops early if the dead state is reached
+*/
+size_t DenseAutomataRun(const DenseAutomata* dense_automata, string sequence);
+
+/*
+	Runs the automata over the whole sequence and returns true if it stops in an accepting state
+*/
+bool DenseAutomataAccepts(const DenseAutomata* dense_automata, string sequence);
+
+/*
+	The same as DenseAutomataAccepts for every sequence. DENSE_AUTOMATA_BATCH_LANES sequences are run at the
+	same time, interleaved one byte each, such that the table loads of the different sequences overlap instead
+	of waiting on each other. Bit index of results is set if sequence index is accepted, the results must have
+	room for (count + 63) / 64 words
+*/
+void DenseAutomataAcceptsBatch(const DenseAutomata* dense_automata, const string* sequences, size_t count, uint64_t* results);
+
+/*
+	Returns the length of the longest prefix of the sequence that is accepted or DENSE_AUTOMATA_NO_MATCH.
+	It stops at the end of the sequence or when the dead state is reached
+*/
+size_t DenseAutomataLongestMatch(const DenseAutomata* dense_automata, string sequence);
+
+/*
+	A single transition, the dead state is returned for the undefined ones
+*/
+unsigned int DenseAutomataStep(const DenseAutomata* dense_automata, unsigned int state, unsigned char terminal);
+
+bool DenseAutomataIsAccepting(const DenseAutomata* dense_automata, unsigned int state);
+
+void DestroyDenseAutomata(DenseAutomata* dense_automata);
@@ -0,0 +1,92 @@
+#include "FileMapping.h"
+#include <stdint.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MapFile(const char* path, MappedFile* mapped_file)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	// A 32 bit process cannot address the whole file, the size would be truncated as well
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || (unsigned long long)file_size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	// The view keeps a reference to the mapping and the file, the handles can be closed right away
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == NULL) {
+		return false;
+	}
+
+	mapped_file->view = view;
+	mapped_file->contents = (string){ view, (size_t)file_size.QuadPart };
+	return true;
+}
+
+void UnmapFile(MappedFile* mapped_file)
+{
+	if (mapped_file->view != NULL) {
+		UnmapViewOfFile(mapped_file->view);
+	}
+	memset(mapped_file, 0, sizeof(*mapped_file));
+}
+
+#else
+
+bool MapFile(const char* path, MappedFile* mapped_file)
+{
+	int file = open(path, O_RDONLY);
+	if (file == -1) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(file, &file_stat) == -1 || file_stat.st_size == 0 || (unsigned long long)file_stat.st_size > SIZE_MAX) {
+		close(file);
+		return false;
+	}
+
+	void* view = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping keeps its own reference to the file
+	close(file);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+	// The scanner walks the file front to back, let the kernel read ahead aggressively
+	madvise(view, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+
+	mapped_file->contents = (string){ view, (size_t)file_stat.st_size };
+	return true;
+}
+
+void UnmapFile(MappedFile* mapped_file)
+{
+	if (mapped_file->contents.characters != NULL) {
+		munmap(mapped_file->contents.characters, mapped_file->contents.size);
+	}
+	memset(mapped_file, 0, sizeof(*mapped_file));
+}
+
+#endif
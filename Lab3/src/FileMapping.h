@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include "StringUtilities.h"
+
+typedef struct {
+	// A read only view of the whole file. It is not null terminated
+	string contents;
+#ifdef _WIN32
+	void* view;
+#endif
+} MappedFile;
+
+/*
+	Maps the whole file in read only mode into the address space (MapViewOfFile on Windows, mmap elsewhere).
+	The pages are brought in by the OS on demand, so no heap buffer of the file size is needed.
+	Returns false if the file could not be opened, if it is empty or if it does not fit into the address space.
+*/
+bool MapFile(const char* path, MappedFile* mapped_file);
+
+/*
+	Releases the view created by MapFile. The contents must not be referenced afterwards.
+*/
+void UnmapFile(MappedFile* mapped_file);
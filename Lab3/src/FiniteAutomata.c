@@ -1,218 +1,646 @@
 #include "FiniteAutomata.h"
 #include "StringUtilities.h"
+#include "TypedHashTable.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int FAStateNameCompare(const void* first, const void* second) {
+	return StringEqual(*(const string*)first, *(const string*)second);
+}
+
+static size_t FAStateNameHash(const void* identifier) {
+	const string* name = identifier;
+	// FNV-1a over the bytes, the high half is folded in since the table keeps only the low bits
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t index = 0; index < name->size; index++) {
+		hash ^= (unsigned char)name->characters[index];
+		hash *= 1099511628211ull;
+	}
+	return (size_t)(hash ^ (hash >> 32));
+}
+
+static HashTable CreateFAStateIndex(size_t capacity) {
+	return CreateTable(capacity, sizeof(size_t), sizeof(string), HashTableMapPowerOfTwo, FAStateNameHash, FAStateNameCompare);
+}
+
+HASH_TABLE_TYPED(FATransitionTable, size_t, FATableEntry, TypedHashTableHashSizeT, TypedHashTableCompareSizeT, TypedHashTableMapPowerOfTwo)
 
 FiniteAutomata CreateFiniteAutomata() {
 	FiniteAutomata fa;
 
 	fa.states = CreateStream(0, sizeof(string));
+	fa.state_indices = CreateFAStateIndex(32);
+	fa.state_names_buffer = NULL;
 	fa.alphabet = CreateStream(0, sizeof(char));
 	fa.final_states = CreateStream(0, sizeof(size_t));
 	fa.initial_state = -1;
-	fa.transitions = CreateTable(
-		32,
-		sizeof(FATableEntry),
-		sizeof(size_t),
-		HashTableMapPowerOfTwo,
-		HashTableHashSizeT,
-		HashTableCompareSizeT
-	);
+	fa.transitions = CreateFATransitionTable(32);
+	memset(&fa.compiled, 0, sizeof(fa.compiled));
+	memset(&fa.bit_parallel, 0, sizeof(fa.bit_parallel));
+	fa.lazy = NULL;
+	fa.verify_mode = FA_VERIFY_DENSE;
+	memset(&fa.determinize_statistics, 0, sizeof(fa.determinize_statistics));
+	memset(&fa.minimize_statistics, 0, sizeof(fa.minimize_statistics));
 
 	return fa;
 }
 
+/*
+	Sizes the state name index and the transitions table such that state_count states fit without a grow.
+	The automata must not have any states yet
+*/
+static void ReserveFAStates(FiniteAutomata* finite_automata, size_t state_count) {
+	size_t capacity = 32;
+	while (capacity * HASH_TABLE_MAX_LOAD_FACTOR / 100 <= state_count) {
+		capacity <<= 1;
+	}
+
+	DestroyTable(&finite_automata->state_indices);
+	DestroyTable(&finite_automata->transitions);
+	finite_automata->state_indices = CreateFAStateIndex(capacity);
+	finite_automata->transitions = CreateFATransitionTable(capacity);
+	Reserve(&finite_automata->states, state_count);
+}
+
+/*
+	The name must stay valid as long as the automata. A repeated name is added to the states, but the
+	index keeps resolving it to the first one
+*/
+static void AddFAState(FiniteAutomata* finite_automata, string name) {
+	size_t state_index = finite_automata->states.size;
+	Add(&finite_automata->states, &name);
+	int inserted;
+	FindOrInsertTable(&finite_automata->state_indices, &state_index, &name, &inserted);
+}
+
 size_t FindFAStateIndex(const FiniteAutomata* finite_automata, string state_string)
 {
-	return FindStringInStream(finite_automata->states, state_string);
+	const size_t* state_index = FindTablePtr(&finite_automata->state_indices, &state_string);
+	return state_index == NULL ? -1 : *state_index;
+}
+
+/*
+	Parses a list of terminals with ranges, like a-zA-Z_, into transitions without the target state.
+	Returns false if a range is reversed
+*/
+static bool ParseTerminalRanges(string terminals, ResizableStream* ranges) {
+	size_t index = 0;
+	while (index < terminals.size) {
+		FATransition range;
+		range.target_state_index = -1;
+		range.first_terminal = terminals.characters[index];
+		range.last_terminal = range.first_terminal;
+		if (index + 2 < terminals.size && terminals.characters[index + 1] == '-') {
+			range.last_terminal = terminals.characters[index + 2];
+			if (range.last_terminal < range.first_terminal) {
+				return false;
+			}
+			index += 3;
+		}
+		else {
+			index++;
+		}
+		Add(ranges, &range);
+	}
+	return true;
+}
+
+// Returns the contents between the braces of a line that starts with the prefix, an empty string if the line is malformed
+static string ParseFALineList(string line, const char* prefix) {
+	if (!StringStartsWith(line, StringFromLiteral(prefix))) {
+		return InvalidString();
+	}
+	return ParseStringInBetween(line, '{', '}');
+}
+
+static string ParseFALineToken(string* parse_range, char separator) {
+	return StringRemoveLeadingAndEndingChar(ParseNextTokenByCharacter(parse_range, separator), ' ', ' ');
 }
 
 bool ReadFiniteAutomataFile(const char* path, FiniteAutomata* finite_automata) {
 	string file = ReadFile(path);
 	if (file.size == 0) {
+		free(file.characters);
 		return false;
 	}
+	// The state names point into the file, it is released together with the automata
+	finite_automata->state_names_buffer = file.characters;
 
-	ResizableStream lines = CreateStream(0, sizeof(string));
-	ParseTokensFromLines(file, &lines);
-
-#define DEALLOCATE free(file.characters); FreeStream(lines);
-
-	if (lines.size != 5) {
-		DEALLOCATE;
+	string lines[5];
+	string remaining_file = file;
+	for (size_t index = 0; index < 5; index++) {
+		lines[index] = ParseNextTokenByCharacter(&remaining_file, '\n');
+	}
+	if (lines[4].size == 0 || ParseNextTokenByCharacter(&remaining_file, '\n').size > 0) {
 		return false;
 	}
 
-	string* first_line = GetElement(lines, 0);
-	if (!StringStartsWith(*first_line, StringFromLiteral("alphabet = {"))) {
-		DEALLOCATE;
+	string alphabet_identifier = ParseFALineList(lines[0], "alphabet = {");
+	if (alphabet_identifier.size == 0) {
 		return false;
 	}
-	string alphabet_identifier = ParseStringInBetween(*first_line, '{', '}');
-	if (alphabet_identifier.size == 0) {
-		DEALLOCATE;
+	ResizableStream alphabet_ranges = CreateStream(8, sizeof(FATransition));
+	if (!ParseTerminalRanges(alphabet_identifier, &alphabet_ranges)) {
+		FreeStream(alphabet_ranges);
 		return false;
 	}
-	ResizableStream alphabet_identifier_stream;
-	alphabet_identifier_stream.buffer = alphabet_identifier.characters;
-	alphabet_identifier_stream.element_size = sizeof(char);
-	alphabet_identifier_stream.size = alphabet_identifier.size + 1;
-	alphabet_identifier.characters[alphabet_identifier.size] = '\0';
-	FreeStream(finite_automata->alphabet);
-	finite_automata->alphabet = CopyStream(alphabet_identifier_stream);
+	// The ranges are expanded, the alphabet buffer is kept null terminated
+	finite_automata->alphabet.size = 0;
+	for (size_t index = 0; index < alphabet_ranges.size; index++) {
+		const FATransition* range = GetElement(alphabet_ranges, index);
+		for (size_t terminal = range->first_terminal; terminal <= range->last_terminal; terminal++) {
+			char character = (char)terminal;
+			Add(&finite_automata->alphabet, &character);
+		}
+	}
+	char null_terminator = '\0';
+	Add(&finite_automata->alphabet, &null_terminator);
 	finite_automata->alphabet.size--;
+	FreeStream(alphabet_ranges);
 
-	string* second_line = GetElement(lines, 1);
-	if (!StringStartsWith(*second_line, StringFromLiteral("states = {"))) {
-		DEALLOCATE;
-		return false;
-	}
-	string states_range = ParseStringInBetween(*second_line, '{', '}');
+	string states_range = ParseFALineList(lines[1], "states = {");
 	if (states_range.size == 0) {
-		DEALLOCATE;
 		return false;
 	}
 
-	ResizableStream states_tokens = CreateStream(8, sizeof(string));
-	ParseTokensByCharacter(states_range, ',', &states_tokens);
-	for (size_t index = 0; index < states_tokens.size; index++) {
-		string* token = GetElement(states_tokens, index);
-		*token = StringRemoveLeadingAndEndingChar(*token, ' ', ' ');
-		string stable_token = StringMallocCopy(*token);
-		Add(&finite_automata->states, &stable_token);
+	// Every state is separated by a comma, this is an upper bound on the state count
+	size_t state_count = 1;
+	for (size_t index = 0; index < states_range.size; index++) {
+		state_count += states_range.characters[index] == ',';
 	}
-	FreeStream(states_tokens);
-
-	string* third_line = GetElement(lines, 2);
-	if (!StringStartsWith(*third_line, StringFromLiteral("transitions = {"))) {
-		DEALLOCATE;
-		return false;
+	ReserveFAStates(finite_automata, state_count);
+	while (states_range.size > 0) {
+		string state_name = ParseFALineToken(&states_range, ',');
+		if (state_name.size > 0) {
+			AddFAState(finite_automata, state_name);
+		}
 	}
-	string transitions_range = ParseStringInBetween(*third_line, '{', '}');
+
+	string transitions_range = ParseFALineList(lines[2], "transitions = {");
 	if (transitions_range.size == 0) {
-		DEALLOCATE;
 		return false;
 	}
 
-	ResizableStream transition_tokens = CreateStream(8, sizeof(string));
-	ParseTokensByCharacter(transitions_range, ',', &transition_tokens);
-	for (size_t index = 0; index < transition_tokens.size; index++) {
-		string* token = GetElement(transition_tokens, index);
-		*token = StringRemoveLeadingAndEndingChar(*token, ' ', ' ');
-		ResizableStream parsed_values = CreateStream(3, sizeof(string));
-		ParseTokensByCharacter(*token, '|', &parsed_values);
-		if (parsed_values.size != 3) {
-			FreeStream(parsed_values);
-			FreeStream(transition_tokens);
-			DEALLOCATE;
+	while (transitions_range.size > 0) {
+		string transition_token = ParseFALineToken(&transitions_range, ',');
+		if (transition_token.size == 0) {
+			continue;
+		}
+
+		string state_token = ParseNextTokenByCharacter(&transition_token, '|');
+		string parsed_terminal = ParseNextTokenByCharacter(&transition_token, '|');
+		string target_state_token = ParseNextTokenByCharacter(&transition_token, '|');
+		if (target_state_token.size == 0 || ParseNextTokenByCharacter(&transition_token, '|').size > 0) {
 			return false;
 		}
 
-		size_t state_index = FindFAStateIndex(finite_automata, *(string*)GetElement(parsed_values, 0));
-		if (state_index == -1) {
-			FreeStream(parsed_values);
-			FreeStream(transition_tokens);
-			DEALLOCATE;
+		size_t state_index = FindFAStateIndex(finite_automata, state_token);
+		size_t target_state_index = FindFAStateIndex(finite_automata, target_state_token);
+		if (state_index == -1 || target_state_index == -1) {
 			return false;
 		}
 
-		FATableEntry* entry = FindTablePtr(&finite_automata->transitions, &state_index);
-		string parsed_terminal = *(string*)GetElement(parsed_values, 1);
-		if (entry == NULL) {
-			FATableEntry new_entry;
-			new_entry.stream = CreateStream(parsed_terminal.size, sizeof(FATransition));
+		// The stream of a new entry is created only once the entry is in the table
+		FATableEntry new_entry;
+		memset(&new_entry, 0, sizeof(new_entry));
+		int inserted;
+		FATableEntry* entry = FindOrInsertFATransitionTablePtr(&finite_automata->transitions, &new_entry, &state_index, &inserted);
+		if (inserted) {
+			entry->stream = CreateStream(1, sizeof(FATransition));
+		}
 
-			for (size_t terminal_index = 0; terminal_index < parsed_terminal.size; terminal_index++) {
-				FATransition transition;
-				transition.terminal = parsed_terminal.characters[terminal_index];
-				transition.target_state_index = FindFAStateIndex(finite_automata, *(string*)GetElement(parsed_values, 2));
-				Add(&new_entry.stream, &transition);
-			}
-			int should_resize = AddTable(&finite_automata->transitions, &new_entry, &state_index);
-			if (should_resize) {
-				GrowTable(&finite_automata->transitions, HashTableGrowPowerOfTwo);
-			}
+		size_t first_range = entry->stream.size;
+		if (!ParseTerminalRanges(parsed_terminal, &entry->stream)) {
+			return false;
 		}
-		else {
-			for (size_t terminal_index = 0; terminal_index < parsed_terminal.size; terminal_index++) {
-				FATransition transition;
-				transition.terminal = parsed_terminal.characters[terminal_index];
-				transition.target_state_index = FindFAStateIndex(finite_automata, *(string*)GetElement(parsed_values, 2));
-				Add(&entry->stream, &transition);
-			}
+		for (size_t range_index = first_range; range_index < entry->stream.size; range_index++) {
+			FATransition* transition = GetElement(entry->stream, range_index);
+			transition->target_state_index = target_state_index;
 		}
-		FreeStream(parsed_values);
 	}
-	FreeStream(transition_tokens);
 
-	string* fourth_line = GetElement(lines, 3);
-	if (!StringStartsWith(*fourth_line, StringFromLiteral("initial_state = "))) {
-		DEALLOCATE;
+	if (!StringStartsWith(lines[3], StringFromLiteral("initial_state = "))) {
 		return false;
 	}
-	string initial_state_after_equal = FindCharacter(*fourth_line, '=');
-	initial_state_after_equal = StringAdvance(initial_state_after_equal, 1);
-	initial_state_after_equal = StringRemoveLeadingAndEndingChar(initial_state_after_equal, ' ', ' ');
-	string initial_state_token = initial_state_after_equal;
+	string initial_state_token = StringAdvance(FindCharacter(lines[3], '='), 1);
+	initial_state_token = StringRemoveLeadingAndEndingChar(initial_state_token, ' ', ' ');
 	size_t initial_state_index = FindFAStateIndex(finite_automata, initial_state_token);
 	if (initial_state_index == -1) {
-		DEALLOCATE;
 		return false;
 	}
 	finite_automata->initial_state = initial_state_index;
 
-	string* fifth_line = GetElement(lines, 4);
-	if (!StringStartsWith(*fifth_line, StringFromLiteral("final_states = {"))) {
-		DEALLOCATE;
+	string final_state_range = ParseFALineList(lines[4], "final_states = {");
+	if (final_state_range.size == 0) {
 		return false;
 	}
 
-	string final_state_range = ParseStringInBetween(*fifth_line, '{', '}');
-	if (final_state_range.size == 0) {
-		DEALLOCATE;
+	while (final_state_range.size > 0) {
+		string final_state_token = ParseFALineToken(&final_state_range, ',');
+		if (final_state_token.size == 0) {
+			continue;
+		}
+		size_t final_state_index = FindFAStateIndex(finite_automata, final_state_token);
+		if (final_state_index == -1) {
+			return false;
+		}
+		Add(&finite_automata->final_states, &final_state_index);
+	}
+
+	return CompileFiniteAutomata(finite_automata);
+}
+
+typedef struct {
+	NFA* nfa;
+	size_t state_offset;
+	const bool* allowed_terminals;
+} FANFAData;
+
+static int IterateAddNFATransitions(void* element, void* identifier, void* extra_data) {
+	FANFAData* data = extra_data;
+	const FATableEntry* entry = element;
+	size_t state_index = *(size_t*)identifier;
+
+	for (size_t index = 0; index < entry->stream.size; index++) {
+		const FATransition* transition = GetElement(entry->stream, index);
+		size_t state = data->state_offset + state_index;
+		size_t target_state = data->state_offset + transition->target_state_index;
+		if (data->allowed_terminals == NULL) {
+			AddNFATransition(data->nfa, state, transition->first_terminal, transition->last_terminal, target_state);
+			continue;
+		}
+
+		// The range is split into the runs of allowed terminals
+		size_t terminal = transition->first_terminal;
+		while (terminal <= transition->last_terminal) {
+			if (!data->allowed_terminals[terminal]) {
+				terminal++;
+				continue;
+			}
+			size_t run_start = terminal;
+			while (terminal <= transition->last_terminal && data->allowed_terminals[terminal]) {
+				terminal++;
+			}
+			AddNFATransition(data->nfa, state, (unsigned char)run_start, (unsigned char)(terminal - 1), target_state);
+		}
+	}
+	return 0;
+}
+
+size_t AddFiniteAutomataToNFA(NFA* nfa, const FiniteAutomata* finite_automata, size_t accept_label, const bool* allowed_terminals)
+{
+	size_t state_offset = nfa->states.size;
+	for (size_t index = 0; index < finite_automata->states.size; index++) {
+		AddNFAState(nfa, DENSE_AUTOMATA_NO_LABEL);
+	}
+	for (size_t index = 0; index < finite_automata->final_states.size; index++) {
+		NFAState* state = GetElement(nfa->states, state_offset + *(size_t*)GetElement(finite_automata->final_states, index));
+		state->accept_label = min(state->accept_label, accept_label);
+	}
+
+	FANFAData data;
+	data.nfa = nfa;
+	data.state_offset = state_offset;
+	data.allowed_terminals = allowed_terminals;
+	IterateTable(&finite_automata->transitions, IterateAddNFATransitions, &data);
+	return state_offset;
+}
+
+static NFA FiniteAutomataToNFA(const FiniteAutomata* finite_automata) {
+	NFA nfa = CreateNFA();
+	size_t state_offset = AddFiniteAutomataToNFA(&nfa, finite_automata, 0, NULL);
+	AddNFAInitialState(&nfa, state_offset + finite_automata->initial_state);
+	return nfa;
+}
+
+static bool DeterminizeToDense(const FiniteAutomata* finite_automata, size_t max_state_count, DenseAutomata* dense_automata) {
+	if (finite_automata->initial_state == -1) {
 		return false;
 	}
 
-	ResizableStream final_state_tokens = CreateStream(8, sizeof(string));
-	ParseTokensByCharacter(final_state_range, ',', &final_state_tokens);
-	for (size_t index = 0; index < final_state_tokens.size; index++) {
-		string* token = GetElement(final_state_tokens, index);
-		*token = StringRemoveLeadingAndEndingChar(*token, ' ', ' ');
-		size_t final_state_index = FindFAStateIndex(finite_automata, *token);
-		if (final_state_index == -1) {
-			FreeStream(final_state_tokens);
-			DEALLOCATE;
+	NFA nfa = FiniteAutomataToNFA(finite_automata);
+	bool success = DeterminizeNFA(&nfa, max_state_count, dense_automata);
+	DestroyNFA(&nfa);
+	return success;
+}
+
+// The dense tables always have the dead state, it is not counted
+static size_t DenseLiveStateCount(const DenseAutomata* dense_automata) {
+	return dense_automata->state_count - 1;
+}
+
+/*
+	Converts the dense table back into states and transitions. The dead state and the transitions into it are dropped
+*/
+static void FiniteAutomataFromDense(const FiniteAutomata* original, const DenseAutomata* dense_automata, FiniteAutomata* result) {
+	*result = CreateFiniteAutomata();
+	FreeStream(result->alphabet);
+	// The alphabet buffer is kept null terminated
+	ResizableStream alphabet = original->alphabet;
+	alphabet.size++;
+	result->alphabet = CopyStream(alphabet);
+	result->alphabet.size--;
+
+	// All the names are written into a single allocation
+	size_t live_state_count = DenseLiveStateCount(dense_automata);
+	size_t names_size = 0;
+	for (size_t state = 0; state < live_state_count; state++) {
+		names_size += snprintf(NULL, 0, "q%zu", state) + 1;
+	}
+	result->state_names_buffer = malloc(sizeof(char) * names_size);
+	ReserveFAStates(result, live_state_count);
+
+	char* state_name = result->state_names_buffer;
+	for (size_t state = 1; state < dense_automata->state_count; state++) {
+		int state_name_size = sprintf(state_name, "q%zu", state - 1);
+		AddFAState(result, (string) { state_name, (size_t)state_name_size });
+		state_name += state_name_size + 1;
+
+		if (dense_automata->accept_labels[state] != DENSE_AUTOMATA_NO_LABEL) {
+			size_t final_state = state - 1;
+			Add(&result->final_states, &final_state);
+		}
+
+		// The consecutive terminals with the same target become a single range
+		FATableEntry entry;
+		entry.stream = CreateStream(0, sizeof(FATransition));
+		size_t terminal = 0;
+		while (terminal < DENSE_AUTOMATA_ALPHABET_SIZE) {
+			unsigned int target = DenseAutomataStep(dense_automata, (unsigned int)state, (unsigned char)terminal);
+			size_t range_start = terminal;
+			while (terminal < DENSE_AUTOMATA_ALPHABET_SIZE && DenseAutomataStep(dense_automata, (unsigned int)state, (unsigned char)terminal) == target) {
+				terminal++;
+			}
+			if (target != DENSE_AUTOMATA_DEAD_STATE) {
+				FATransition transition;
+				transition.target_state_index = target - 1;
+				transition.first_terminal = (unsigned char)range_start;
+				transition.last_terminal = (unsigned char)(terminal - 1);
+				Add(&entry.stream, &transition);
+			}
+		}
+
+		if (entry.stream.size > 0) {
+			size_t state_index = state - 1;
+			AddFATransitionTable(&result->transitions, &entry, &state_index);
+		}
+		else {
+			FreeStream(entry.stream);
+		}
+	}
+	result->initial_state = dense_automata->initial_state - 1;
+}
+
+static void DestroyFALazyAutomata(FiniteAutomata* finite_automata) {
+	if (finite_automata->lazy != NULL) {
+		DestroyLazyAutomata(finite_automata->lazy);
+		free(finite_automata->lazy);
+		finite_automata->lazy = NULL;
+	}
+}
+
+bool CompileFiniteAutomata(FiniteAutomata* finite_automata)
+{
+	return CompileFiniteAutomataWithMode(finite_automata, FA_VERIFY_AUTOMATIC);
+}
+
+bool CompileFiniteAutomataWithMode(FiniteAutomata* finite_automata, FA_VERIFY_MODE mode)
+{
+	if (finite_automata->initial_state == -1) {
+		return false;
+	}
+
+	DestroyDenseAutomata(&finite_automata->compiled);
+	DestroyBitParallelAutomata(&finite_automata->bit_parallel);
+	DestroyFALazyAutomata(finite_automata);
+
+	DenseAutomata deterministic;
+	bool is_dense = false;
+	if (mode == FA_VERIFY_AUTOMATIC || mode == FA_VERIFY_DENSE) {
+		size_t max_state_count = mode == FA_VERIFY_AUTOMATIC ? FINITE_AUTOMATA_MAX_DENSE_STATES : DENSE_AUTOMATA_UNLIMITED_STATES;
+		is_dense = DeterminizeToDense(finite_automata, max_state_count, &deterministic);
+		if (!is_dense && mode == FA_VERIFY_DENSE) {
 			return false;
 		}
+	}
 
-		Add(&finite_automata->final_states, &final_state_index);
+	if (!is_dense) {
+		NFA nfa = FiniteAutomataToNFA(finite_automata);
+		if (mode == FA_VERIFY_BIT_PARALLEL) {
+			CreateBitParallelAutomata(&nfa, &finite_automata->bit_parallel);
+			finite_automata->verify_mode = FA_VERIFY_BIT_PARALLEL;
+		}
+		else {
+			finite_automata->lazy = malloc(sizeof(LazyAutomata));
+			CreateLazyAutomata(&nfa, LAZY_AUTOMATA_DEFAULT_CACHE_SIZE, finite_automata->lazy);
+			finite_automata->verify_mode = FA_VERIFY_LAZY;
+		}
+		DestroyNFA(&nfa);
+
+		finite_automata->determinize_statistics.state_count_before = finite_automata->states.size;
+		finite_automata->determinize_statistics.state_count_after = finite_automata->states.size;
+		finite_automata->minimize_statistics = finite_automata->determinize_statistics;
+		return true;
 	}
 
-	FreeStream(final_state_tokens);
-	DEALLOCATE;
+	finite_automata->verify_mode = FA_VERIFY_DENSE;
+	MinimizeDenseAutomata(&deterministic, &finite_automata->compiled);
+
+	finite_automata->determinize_statistics.state_count_before = finite_automata->states.size;
+	finite_automata->determinize_statistics.state_count_after = DenseLiveStateCount(&deterministic);
+	finite_automata->minimize_statistics.state_count_before = DenseLiveStateCount(&deterministic);
+	finite_automata->minimize_statistics.state_count_after = DenseLiveStateCount(&finite_automata->compiled);
+	DestroyDenseAutomata(&deterministic);
 	return true;
-#undef DEALLOCATE
 }
 
-bool FABacktracking(const FiniteAutomata* finite_automata, size_t current_state, string sequence) {
-	if (sequence.size == 0) {
-		return Find(finite_automata->final_states, &current_state) != -1;
+bool DeterminizeFiniteAutomata(const FiniteAutomata* finite_automata, FiniteAutomata* result, FAPassStatistics* statistics)
+{
+	DenseAutomata deterministic;
+	if (!DeterminizeToDense(finite_automata, DENSE_AUTOMATA_UNLIMITED_STATES, &deterministic)) {
+		return false;
+	}
+
+	FiniteAutomataFromDense(finite_automata, &deterministic, result);
+	if (statistics != NULL) {
+		statistics->state_count_before = finite_automata->states.size;
+		statistics->state_count_after = DenseLiveStateCount(&deterministic);
+	}
+	DestroyDenseAutomata(&deterministic);
+	return CompileFiniteAutomata(result);
+}
+
+bool MinimizeFiniteAutomata(const FiniteAutomata* finite_automata, FiniteAutomata* result, FAPassStatistics* statistics)
+{
+	DenseAutomata deterministic;
+	if (!DeterminizeToDense(finite_automata, DENSE_AUTOMATA_UNLIMITED_STATES, &deterministic)) {
+		return false;
 	}
 
-	FATableEntry* entry = GetTablePtr(&finite_automata->transitions, current_state);
-	for (size_t index = 0; index < entry->stream.size; index++) {
-		FATransition* transition = GetElement(entry->stream, index);
-		if (transition->terminal == sequence.characters[0]) {
-			if (FABacktracking(finite_automata, transition->target_state_index, StringAdvance(sequence, 1))) {
-				return true;
-			}
+	DenseAutomata minimized;
+	MinimizeDenseAutomata(&deterministic, &minimized);
+	FiniteAutomataFromDense(finite_automata, &minimized, result);
+	if (statistics != NULL) {
+		statistics->state_count_before = finite_automata->states.size;
+		statistics->state_count_after = DenseLiveStateCount(&minimized);
+	}
+	DestroyDenseAutomata(&minimized);
+	DestroyDenseAutomata(&deterministic);
+	return CompileFiniteAutomata(result);
+}
+
+bool FiniteAutomataVerifySequence(FiniteAutomata* finite_automata, string sequence)
+{
+	if (finite_automata->verify_mode == FA_VERIFY_BIT_PARALLEL) {
+		return BitParallelAutomataAccepts(&finite_automata->bit_parallel, sequence);
+	}
+	if (finite_automata->verify_mode == FA_VERIFY_LAZY) {
+		return LazyAutomataAccepts(finite_automata->lazy, sequence);
+	}
+	if (finite_automata->compiled.transitions == NULL) {
+		return false;
+	}
+	return DenseAutomataAccepts(&finite_automata->compiled, sequence);
+}
+
+void FiniteAutomataVerifyBatch(FiniteAutomata* finite_automata, const string* sequences, size_t count, uint64_t* results)
+{
+	if (finite_automata->verify_mode == FA_VERIFY_DENSE && finite_automata->compiled.transitions != NULL) {
+		DenseAutomataAcceptsBatch(&finite_automata->compiled, sequences, count, results);
+		return;
+	}
+
+	memset(results, 0, sizeof(uint64_t) * ((count + 63) / 64));
+	for (size_t index = 0; index < count; index++) {
+		if (FiniteAutomataVerifySequence(finite_automata, sequences[index])) {
+			results[index / 64] |= (uint64_t)1 << (index % 64);
 		}
 	}
-	return false;
 }
 
-bool FiniteAutomataVerifySequence(const FiniteAutomata* finite_automata, string sequence)
+size_t FiniteAutomataLongestMatch(FiniteAutomata* finite_automata, string input)
 {
-	return FABacktracking(finite_automata, finite_automata->initial_state, sequence);
+	if (finite_automata->verify_mode == FA_VERIFY_BIT_PARALLEL) {
+		return BitParallelAutomataLongestMatch(&finite_automata->bit_parallel, input);
+	}
+	if (finite_automata->verify_mode == FA_VERIFY_LAZY) {
+		return LazyAutomataLongestMatch(finite_automata->lazy, input);
+	}
+	if (finite_automata->compiled.transitions == NULL) {
+		return FA_NO_MATCH;
+	}
+	return DenseAutomataLongestMatch(&finite_automata->compiled, input);
+}
+
+// The lazy automatas run with their bit parallel simulation, since a cursor could not keep
+// its state if another cursor of the same automata cleared the cache
+static const BitParallelAutomata* LockstepBitParallel(const FiniteAutomata* finite_automata) {
+	if (finite_automata->verify_mode == FA_VERIFY_BIT_PARALLEL) {
+		return &finite_automata->bit_parallel;
+	}
+	if (finite_automata->verify_mode == FA_VERIFY_LAZY) {
+		return &finite_automata->lazy->nfa;
+	}
+	return NULL;
+}
+
+// The position of one automata during the lockstep run
+typedef struct {
+	unsigned int dense_state;
+	// Only for the bit parallel and the lazy automatas, both sets are in the same allocation
+	uint64_t* sets;
+	uint64_t* current;
+	uint64_t* next;
+	bool is_active;
+} LockstepCursor;
+
+static bool LockstepIsAccepting(const FiniteAutomata* finite_automata, const LockstepCursor* cursor) {
+	const BitParallelAutomata* bit_parallel = LockstepBitParallel(finite_automata);
+	if (bit_parallel != NULL) {
+		return BitParallelAutomataIsAccepting(bit_parallel, cursor->current);
+	}
+	return DenseAutomataIsAccepting(&finite_automata->compiled, cursor->dense_state);
+}
+
+size_t FiniteAutomataLongestMatchMany(const FiniteAutomata* const* finite_automatas, size_t count, string input, size_t* matched_automata)
+{
+	size_t longest_match = FA_NO_MATCH;
+	size_t longest_match_automata = -1;
+
+	LockstepCursor* cursors = malloc(sizeof(LockstepCursor) * count);
+	size_t active_count = 0;
+	for (size_t index = 0; index < count; index++) {
+		const FiniteAutomata* finite_automata = finite_automatas[index];
+		LockstepCursor* cursor = cursors + index;
+		cursor->sets = NULL;
+		const BitParallelAutomata* bit_parallel = LockstepBitParallel(finite_automata);
+		if (bit_parallel != NULL) {
+			size_t word_count = bit_parallel->word_count;
+			cursor->sets = malloc(sizeof(uint64_t) * word_count * 2);
+			cursor->current = cursor->sets;
+			cursor->next = cursor->current + word_count;
+			memcpy(cursor->current, bit_parallel->initial_states, sizeof(uint64_t) * word_count);
+			cursor->is_active = true;
+		}
+		else {
+			cursor->is_active = finite_automata->compiled.transitions != NULL;
+			cursor->dense_state = cursor->is_active ? finite_automata->compiled.initial_state : DENSE_AUTOMATA_DEAD_STATE;
+		}
+
+		if (cursor->is_active) {
+			active_count++;
+			if (longest_match == FA_NO_MATCH && LockstepIsAccepting(finite_automata, cursor)) {
+				longest_match = 0;
+				longest_match_automata = index;
+			}
+		}
+	}
+
+	for (size_t position = 0; position < input.size && active_count > 0; position++) {
+		unsigned char terminal = input.characters[position];
+		bool has_match = false;
+		for (size_t index = 0; index < count; index++) {
+			const FiniteAutomata* finite_automata = finite_automatas[index];
+			LockstepCursor* cursor = cursors + index;
+			if (!cursor->is_active) {
+				continue;
+			}
+
+			const BitParallelAutomata* bit_parallel = LockstepBitParallel(finite_automata);
+			if (bit_parallel != NULL) {
+				cursor->is_active = BitParallelAutomataStep(bit_parallel, cursor->current, terminal, cursor->next);
+				uint64_t* temporary = cursor->current;
+				cursor->current = cursor->next;
+				cursor->next = temporary;
+			}
+			else {
+				cursor->dense_state = DenseAutomataStep(&finite_automata->compiled, cursor->dense_state, terminal);
+				cursor->is_active = cursor->dense_state != DENSE_AUTOMATA_DEAD_STATE;
+			}
+
+			if (!cursor->is_active) {
+				active_count--;
+			}
+			else if (!has_match && LockstepIsAccepting(finite_automata, cursor)) {
+				has_match = true;
+				longest_match = position + 1;
+				longest_match_automata = index;
+			}
+		}
+	}
+
+	for (size_t index = 0; index < count; index++) {
+		if (cursors[index].sets != NULL) {
+			free(cursors[index].sets);
+		}
+	}
+	free(cursors);
+
+	if (matched_automata != NULL) {
+		*matched_automata = longest_match_automata;
+	}
+	return longest_match;
 }
 
 int IteratePrintTransitions(void* element, void* identifier, void* user_data) {
@@ -224,25 +652,30 @@ int IteratePrintTransitions(void* element, void* identifier, void* user_data) {
 	for (size_t index = 0; index < entry->stream.size; index++) {
 		FATransition* transition = GetElement(entry->stream, index);
 		string* target_state_string = GetElement(fa->states, transition->target_state_index);
-		printf("%s -> %c -> %s\n", state_string->characters, transition->terminal, target_state_string->characters);
+		if (transition->first_terminal == transition->last_terminal) {
+			printf("%.*s -> %c -> %.*s\n", (int)state_string->size, state_string->characters, transition->first_terminal, (int)target_state_string->size, target_state_string->characters);
+		}
+		else {
+			printf("%.*s -> %c-%c -> %.*s\n", (int)state_string->size, state_string->characters, transition->first_terminal, transition->last_terminal, (int)target_state_string->size, target_state_string->characters);
+		}
 	}
 	return 0;
 }
 
-void FiniteAutomataConsole(const FiniteAutomata* finite_automata)
+void FiniteAutomataConsole(FiniteAutomata* finite_automata)
 {
 	while (true) {
-		printf("Menu Options:\n1. Print states\n2. Print the alphabet\n3. Print all transitions\n4. Print initial state\n5. Print final states\n6. Verify sequence\n7. Exit\nChoose Options: ");
+		printf("Menu Options:\n1. Print states\n2. Print the alphabet\n3. Print all transitions\n4. Print initial state\n5. Print final states\n6. Verify sequence\n7. Print compile statistics\n8. Longest accepted prefix\n9. Exit\nChoose Options: ");
 		int option;
 		scanf("%d", &option);
 
-		if (option == 7) {
+		if (option == 9) {
 			break;
 		}
 		else if (option == 1) {
 			for (size_t index = 0; index < finite_automata->states.size; index++) {
 				string* state = GetElement(finite_automata->states, index);
-				printf("%s\n", state->characters);
+				printf("%.*s\n", (int)state->size, state->characters);
 			}
 		}
 		else if (option == 2) {
@@ -254,12 +687,12 @@ void FiniteAutomataConsole(const FiniteAutomata* finite_automata)
 		}
 		else if (option == 4) {
 			string* initial_state_string = GetElement(finite_automata->states, finite_automata->initial_state);
-			printf("%s\n", initial_state_string->characters);
+			printf("%.*s\n", (int)initial_state_string->size, initial_state_string->characters);
 		}
 		else if (option == 5) {
 			for (size_t index = 0; index < finite_automata->final_states.size; index++) {
 				string* state_string = GetElement(finite_automata->states, *(size_t*)GetElement(finite_automata->final_states, index));
-				printf("%s\n", state_string->characters);
+				printf("%.*s\n", (int)state_string->size, state_string->characters);
 			}
 		}
 		else if (option == 6) {
@@ -273,6 +706,29 @@ void FiniteAutomataConsole(const FiniteAutomata* finite_automata)
 				printf("The sequence is not accepted by the FA\n");
 			}
 		}
+		else if (option == 7) {
+			printf("Subset construction: %zu -> %zu states\n", finite_automata->determinize_statistics.state_count_before, finite_automata->determinize_statistics.state_count_after);
+			printf("Hopcroft minimization: %zu -> %zu states\n", finite_automata->minimize_statistics.state_count_before, finite_automata->minimize_statistics.state_count_after);
+			if (finite_automata->verify_mode == FA_VERIFY_LAZY) {
+				const LazyAutomata* lazy = finite_automata->lazy;
+				printf("Verification: lazy, %zu of %zu states cached, %zu transitions computed, %zu cache flushes\n",
+					lazy->state_count, lazy->max_state_count, lazy->miss_count, lazy->flush_count);
+			}
+			else {
+				printf("Verification: %s\n", finite_automata->verify_mode == FA_VERIFY_BIT_PARALLEL ? "bit parallel" : "dense table");
+			}
+		}
+		else if (option == 8) {
+			char sequence[512];
+			scanf("%s", sequence);
+			size_t longest_match = FiniteAutomataLongestMatch(finite_automata, StringFromLiteral(sequence));
+			if (longest_match == FA_NO_MATCH) {
+				printf("No prefix of the sequence is accepted by the FA\n");
+			}
+			else {
+				printf("The longest accepted prefix is %.*s (%zu characters)\n", (int)longest_match, sequence, longest_match);
+			}
+		}
 	}
 }
 
@@ -285,8 +741,13 @@ int IterateDeallocateTransitions(void* element, void* identifier, void* extra_da
 void DestroyFiniteAutomata(FiniteAutomata* finite_automata) {
 	FreeStream(finite_automata->alphabet);
 	FreeStream(finite_automata->final_states);
-	DeallocateStrings(finite_automata->states);
+	FreeStream(finite_automata->states);
+	DestroyTable(&finite_automata->state_indices);
+	free(finite_automata->state_names_buffer);
 	IterateTable(&finite_automata->transitions, IterateDeallocateTransitions, NULL);
 	DestroyTable(&finite_automata->transitions);
+	DestroyDenseAutomata(&finite_automata->compiled);
+	DestroyBitParallelAutomata(&finite_automata->bit_parallel);
+	DestroyFALazyAutomata(finite_automata);
 	memset(finite_automata, 0, sizeof(*finite_automata));
 }
\ No newline at end of file
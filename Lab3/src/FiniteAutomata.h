@@ -3,10 +3,16 @@
 #include "HashTable.h"
 #include <stdbool.h>
 #include "StringUtilities.h"
+#include "DenseAutomata.h"
+#include "BitParallelAutomata.h"
+#include "LazyAutomata.h"
 
+// A transition on every terminal from first_terminal up to and including last_terminal. In the file format
+// a range is written as a-z, a '-' that is the first or the last terminal of the list is a literal terminal
 typedef struct {
 	size_t target_state_index;
-	char terminal;
+	unsigned char first_terminal;
+	unsigned char last_terminal;
 } FATransition;
 
 typedef struct {
@@ -14,26 +20,103 @@ typedef struct {
 	ResizableStream stream;
 } FATableEntry;
 
+// The subset construction is abandoned above this many deterministic states and
+// the deterministic states are built lazily instead
+#define FINITE_AUTOMATA_MAX_DENSE_STATES 4096
+
+// Returned by the longest match functions when not even the empty prefix is accepted
+#define FA_NO_MATCH DENSE_AUTOMATA_NO_MATCH
+
+typedef enum {
+	// Dense if the subset construction stays under FINITE_AUTOMATA_MAX_DENSE_STATES, else lazy
+	FA_VERIFY_AUTOMATIC,
+	FA_VERIFY_DENSE,
+	FA_VERIFY_BIT_PARALLEL,
+	// The deterministic states are built while verifying, in a cache of LAZY_AUTOMATA_DEFAULT_CACHE_SIZE bytes
+	FA_VERIFY_LAZY
+} FA_VERIFY_MODE;
+
+// The state counts do not include the dead state of the dense tables
+typedef struct {
+	size_t state_count_before;
+	size_t state_count_after;
+} FAPassStatistics;
+
 typedef struct {
 	size_t initial_state;
-	// Element is a string
+	// Element is a string, the names point into state_names_buffer and are not null terminated
 	ResizableStream states;
+	// Identifier is a string, the state name, element is a size_t, index into states
+	HashTable state_indices;
+	// The single allocation that holds the text of all state names. For an automata read from a file
+	// it is the file contents
+	char* state_names_buffer;
 	// Element is a character
 	ResizableStream alphabet;
 	// Element is a size_t, index into states
 	ResizableStream final_states;
 	// Element is FATableEntry, Identifier is size_t, the state index
 	HashTable transitions;
+	// The deterministic table built by CompileFiniteAutomata, used for the verification
+	DenseAutomata compiled;
+	// Used instead of the dense table when the verify mode is bit parallel
+	BitParallelAutomata bit_parallel;
+	// Used instead of the dense table when the verify mode is lazy, NULL otherwise
+	LazyAutomata* lazy;
+	// The mode chosen by the compilation, never automatic
+	FA_VERIFY_MODE verify_mode;
+	FAPassStatistics determinize_statistics;
+	FAPassStatistics minimize_statistics;
 } FiniteAutomata;
 
 FiniteAutomata CreateFiniteAutomata();
 
+// Returns the index of the state with the given name or -1 if there is no such state
 size_t FindFAStateIndex(const FiniteAutomata* finite_automata, string state_string);
 
+// The automata must be freshly created. The file is read into a single buffer that is kept by the automata,
+// the states are resolved through the hashed name index, so the time is linear in the size of the file
 bool ReadFiniteAutomataFile(const char* path, FiniteAutomata* finite_automata);
 
-bool FiniteAutomataVerifySequence(const FiniteAutomata* finite_automata, string sequence);
+// Determinizes and minimizes the automata into a dense state x byte table with an accepting state bitmap.
+// ReadFiniteAutomataFile calls it after a successful read
+bool CompileFiniteAutomata(FiniteAutomata* finite_automata);
+
+// The same as CompileFiniteAutomata, but the verification mode can be forced. In the bit parallel and the lazy
+// modes the statistics report the nondeterministic state count
+bool CompileFiniteAutomataWithMode(FiniteAutomata* finite_automata, FA_VERIFY_MODE mode);
+
+// Builds an equivalent deterministic automata with the subset construction. The result must not be created before.
+// The statistics can be NULL
+bool DeterminizeFiniteAutomata(const FiniteAutomata* finite_automata, FiniteAutomata* result, FAPassStatistics* statistics);
+
+// Builds the minimal deterministic automata with Hopcroft's algorithm. The input can be nondeterministic,
+// it is determinized first. The result must not be created before. The statistics can be NULL
+bool MinimizeFiniteAutomata(const FiniteAutomata* finite_automata, FiniteAutomata* result, FAPassStatistics* statistics);
+
+// Copies the states and transitions into the nfa, the final states receive the accept label.
+// If allowed_terminals is not NULL, only the transitions on the terminals that it allows are copied.
+// Returns the nfa index of the first state
+size_t AddFiniteAutomataToNFA(NFA* nfa, const FiniteAutomata* finite_automata, size_t accept_label, const bool* allowed_terminals);
+
+// The verification functions that take the automata as non const fill in the state cache of the lazy mode and
+// run in the state sets of the bit parallel mode. An automata must not be verified from multiple threads at the same time
+bool FiniteAutomataVerifySequence(FiniteAutomata* finite_automata, string sequence);
+
+// Verifies every sequence, bit index of results is set if sequence index is accepted. The results must have room
+// for (count + 63) / 64 words. With the dense table the sequences are interleaved, which has a much higher
+// throughput than verifying them one by one
+void FiniteAutomataVerifyBatch(FiniteAutomata* finite_automata, const string* sequences, size_t count, uint64_t* results);
+
+// Returns the length of the longest accepted prefix of the input or FA_NO_MATCH
+size_t FiniteAutomataLongestMatch(FiniteAutomata* finite_automata, string input);
+
+// Runs all the automatas in lockstep over the input, in a single pass, until every one of them got stuck.
+// Returns the longest prefix accepted by any of them or FA_NO_MATCH. If multiple automatas accept it,
+// the one with the smallest index wins and it is written into matched_automata, which can be NULL.
+// It only reads the automatas, the lazy ones are simulated bit parallel without their state cache
+size_t FiniteAutomataLongestMatchMany(const FiniteAutomata* const* finite_automatas, size_t count, string input, size_t* matched_automata);
 
-void FiniteAutomataConsole(const FiniteAutomata* finite_automata);
+void FiniteAutomataConsole(FiniteAutomata* finite_automata);
 
 void DestroyFiniteAutomata(FiniteAutomata* finite_automata);
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdbool.h>
+#include "ProgramInternalForm.h"
+
+/*
+	Implemented by the source file that GenerateLexerSource writes. Only the builds that define LEXER_STATIC_TABLES
+	compile that file, the others parse the token and automata files at runtime
+*/
+
+/*
+	Points the token lists, the delimiter trie, the keyword hash, the classifier and the compiled automatas
+	of a freshly created pif to the static tables. Nothing is allocated, unless the keyword set was too big
+	for a perfect hash and its fallback table has to be built
+*/
+void LoadGeneratedLexer(ProgramInternalForm* pif);
+
+/*
+	The same as ClassifyToken for the generated classifier. The table walk and the accept labels are
+	known at compile time, such that the scanner loop can be specialized for them
+*/
+bool GeneratedClassifyToken(string token, Token* result);
@@ -2,9 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
+#include "HashTableProbe.h"
 
 #define HASH_TABLE_DISTANCE_MASK 0xF8
-#define HASH_TABLE_MAX_DISTANCE 32
 
 void* OffsetPointer(const void* pointer, size_t offset) {
 	uintptr_t ptr = (uintptr_t)pointer;
@@ -23,6 +23,34 @@ size_t GetExtendedCapacity(size_t capacity) {
 	return capacity + HASH_TABLE_MAX_DISTANCE;
 }
 
+/*
+	The partitions after the elements are aligned to size_t, the typed tables index them as arrays
+*/
+static size_t AlignTableOffset(size_t offset) {
+	return (offset + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+}
+
+static size_t GetIdentifiersOffset(size_t element_size, size_t extended_capacity) {
+	return AlignTableOffset(element_size * extended_capacity);
+}
+
+static size_t GetHashesOffset(size_t element_size, size_t identifier_size, size_t extended_capacity) {
+	return AlignTableOffset(GetIdentifiersOffset(element_size, extended_capacity) + identifier_size * extended_capacity);
+}
+
+/*
+	Splits the buffer into the elements, identifiers, hashes and metadata. The metadata is the last partition
+	such that the group probing can read past the last slot
+*/
+static void PartitionTable(HashTable* table, void* buffer, size_t capacity) {
+	size_t extended_capacity = GetExtendedCapacity(capacity);
+	table->buffer = buffer;
+	table->identifiers = OffsetPointer(buffer, GetIdentifiersOffset(table->element_size, extended_capacity));
+	table->hashes = OffsetPointer(buffer, GetHashesOffset(table->element_size, table->identifier_size, extended_capacity));
+	table->metadata = OffsetPointer(table->hashes, sizeof(size_t) * extended_capacity);
+	memset(table->metadata, 0, sizeof(unsigned char) * extended_capacity);
+}
+
 int HashTableCompareIntegers(const void* first, const void* second)
 {
 	const unsigned int* first_int = first;
@@ -54,49 +82,65 @@ size_t HashTableHashSizeT(const void* identifier)
 
 size_t HashTableGrowPowerOfTwo(size_t capacity)
 {
-	return capacity << 1;
+	return capacity == 0 ? HASH_TABLE_MIN_CAPACITY : capacity << 1;
+}
+
+size_t HashTablePowerOfTwoCapacity(size_t capacity)
+{
+	size_t power = capacity == 0 ? 0 : 1;
+	while (power < capacity) {
+		power <<= 1;
+	}
+	return power;
 }
 
 HashTable CreateTable(size_t capacity, size_t element_size, size_t identifier_size, HashTableMapFunction map_function, HashTableHashFunction hash_function, HashTableIdentifierCompare compare_function)
 {
 	HashTable table;
+	table.element_size = element_size;
+	table.identifier_size = identifier_size;
 
 	if (capacity > 0) {
 		size_t table_byte_size = MemoryOfTable(element_size, identifier_size, capacity);
-		
-		// Partition the buffer appropriately
-		size_t extended_capacity = GetExtendedCapacity(capacity);
-		table.buffer = malloc(table_byte_size);
-		table.identifiers = OffsetPointer(table.buffer, element_size * extended_capacity);
-		table.metadata = OffsetPointer(table.identifiers, identifier_size * extended_capacity);
-		memset(table.metadata, 0, sizeof(unsigned char) * extended_capacity);
+		PartitionTable(&table, malloc(table_byte_size), capacity);
 	}
 	else {
 		table.buffer = NULL;
 		table.identifiers = NULL;
+		table.hashes = NULL;
 		table.metadata = NULL;
 	}
 
 	table.capacity = capacity;
 	table.size = 0;
-	table.element_size = element_size;
-	table.identifier_size = identifier_size;
 	table.map_function = map_function;
 	table.hash_function = hash_function;
 	table.identifier_compare = compare_function;
 	table.max_search_length = 0;
+	table.grow_function = HashTableGrowPowerOfTwo;
+	table.max_load_factor = HASH_TABLE_MAX_LOAD_FACTOR;
+	table.min_load_factor = HASH_TABLE_MIN_LOAD_FACTOR;
+	table.min_capacity = max(capacity, HASH_TABLE_MIN_CAPACITY);
+	table.resize_step = 0;
+	memset(&table.migration, 0, sizeof(table.migration));
 
 	return table;
 }
 
-int AddTable(HashTable* table, const void* element, const void* identifier)
+/*
+	Robin Hood insertion with the hash already computed, starting from a slot on the probe path of the key (index is
+	at the given distance from the home slot). All the slots before it on the path must be at least as far from their
+	home as the key would be. The hash travels with the element when it is displaced.
+	Fills placed_index, if it is not NULL, with the slot that the new element took. Returns 1 if the element was
+	inserted, else 0 when it does not fit in HASH_TABLE_MAX_DISTANCE slots, and then the table is left untouched
+*/
+static int InsertTableAt(HashTable* table, const void* element, const void* identifier, size_t key, size_t index, unsigned char distance, size_t* placed_index)
 {
-	size_t key = table->hash_function(identifier);
+	if (!HashTableInsertionFits(table->metadata, GetExtendedCapacity(table->capacity), index, distance)) {
+		return 0;
+	}
 
-	// calculating the index at which the key wants to be
-	size_t index = table->map_function(key, table->capacity);
-	size_t hash = index;
-	unsigned char distance = 1;
+	size_t new_element_index = -1;
 
 	void* temp_value = _alloca(table->element_size);
 	void* temp_identifier = _alloca(table->identifier_size);
@@ -119,6 +163,10 @@ int AddTable(HashTable* table, const void* element, const void* identifier)
 			element_distance = GetDistanceIndex(table, index);
 		}
 
+		if (new_element_index == -1) {
+			new_element_index = index;
+		}
+
 		// if the slot is empty, the key can be placed here
 		if (element_distance == 0) {
 			table->metadata[index] = distance;
@@ -126,6 +174,7 @@ int AddTable(HashTable* table, const void* element, const void* identifier)
 			memcpy(table_element, current_element, table->element_size);
 			void* table_identifier = GetTableIdentifierPtr(table, index);
 			memcpy(table_identifier, current_identifier, table->identifier_size);
+			table->hashes[index] = key;
 			table->size++;
 
 			table->max_search_length = max(distance, table->max_search_length);
@@ -145,6 +194,11 @@ int AddTable(HashTable* table, const void* element, const void* identifier)
 			memcpy(table_value, current_element, table->element_size);
 			memcpy(table_identifier, current_identifier, table->identifier_size);
 			table->metadata[index] = distance;
+			// An upsert can start past the longest probe, the swapped in entry may be the farthest one
+			table->max_search_length = max(table->max_search_length, distance);
+			size_t hash_temp = table->hashes[index];
+			table->hashes[index] = key;
+			key = hash_temp;
 
 			distance = metadata_temp + 1;
 			memcpy(current_element, temp_value, table->element_size);
@@ -153,58 +207,262 @@ int AddTable(HashTable* table, const void* element, const void* identifier)
 			index++;
 		}
 	}
-	if ((table->size * 100 / table->capacity > HASH_TABLE_MAX_LOAD_FACTOR) || distance == HASH_TABLE_MAX_DISTANCE)
-		return 1;
-	return 0;
+	if (placed_index != NULL) {
+		*placed_index = new_element_index;
+	}
+	return 1;
 }
 
-size_t FindTable(const HashTable* table, const void* identifier)
+static int InsertTableHome(HashTable* table, const void* element, const void* identifier, size_t key)
+{
+	// calculating the index at which the key wants to be
+	size_t index = table->map_function(key, table->capacity);
+	return InsertTableAt(table, element, identifier, key, index, 1, NULL);
+}
+
+static int IsTableOverloaded(const HashTable* table)
+{
+	return table->size * 100 > table->capacity * table->max_load_factor;
+}
+
+/*
+	Inserts with the resize policy, the table grows until the element fits and once more if the load factor
+	went above the maximum. Returns 1 if the table was resized, -1 if the element cannot be placed at any capacity
+*/
+static int AddTableHashed(HashTable* table, const void* element, const void* identifier, size_t key)
 {
+	int resized = 0;
 	if (table->capacity == 0) {
-		return -1;
+		GrowTable(table, table->grow_function);
+		resized = 1;
+	}
+	FinishTableResizeForKey(table, key);
+	while (!InsertTableHome(table, element, identifier, key)) {
+		if (!GrowTableForKey(table, key)) {
+			return -1;
+		}
+		resized = 1;
 	}
+	if (IsTableOverloaded(table)) {
+		GrowTable(table, table->grow_function);
+		resized = 1;
+	}
+	return resized;
+}
 
-	size_t key = table->hash_function(identifier);
+int AddTable(HashTable* table, const void* element, const void* identifier)
+{
+	MigrateTableSlots(table, table->resize_step);
+	return AddTableHashed(table, element, identifier, table->hash_function(identifier));
+}
 
+/*
+	Searches for the identifier with its hash already computed. When it is not found, stop_index and stop_distance
+	receive the slot where the search stopped, which is where an insertion of the identifier can start
+*/
+static size_t ProbeTable(const HashTable* table, const void* identifier, size_t key, size_t* stop_index, size_t* stop_distance)
+{
 	// calculating the index for the array with the hash function
 	size_t index = table->map_function(key, table->capacity);
+	size_t distance = 1;
+
+#ifdef HASH_TABLE_PROBE_GROUP
+	// The loads must stay inside the metadata, which is the last partition of the buffer
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	while (distance <= table->max_search_length && index + HASH_TABLE_PROBE_GROUP <= extended_capacity) {
+		uint32_t stop_mask;
+		uint32_t match_mask = HashTableMatchDistanceGroup(table->metadata + index, (unsigned char)distance, &stop_mask);
+		match_mask = HashTableLimitGroupMatches(match_mask, stop_mask, table->max_search_length - distance + 1);
+
+		while (match_mask != 0) {
+			size_t match_index = index + HashTableLowestMatch(match_mask);
+			if (table->hashes[match_index] == key && table->identifier_compare(identifier, OffsetPointer(table->identifiers, match_index * table->identifier_size))) {
+				return match_index;
+			}
+			match_mask &= match_mask - 1;
+		}
 
-	for (size_t distance = 1; distance <= table->max_search_length; distance++) {
+		if (stop_mask != 0) {
+			size_t stop_offset = HashTableLowestMatch(stop_mask);
+			*stop_index = index + stop_offset;
+			*stop_distance = distance + stop_offset;
+			return -1;
+		}
+		distance += HASH_TABLE_PROBE_GROUP;
+		index += HASH_TABLE_PROBE_GROUP;
+	}
+#endif
+
+	for (; distance <= table->max_search_length; distance++) {
 		unsigned char current_distance = GetDistanceIndex(table, index);
 		if (current_distance == distance) {
-			// Verify the identifier now
-			if (table->identifier_compare(identifier, OffsetPointer(table->identifiers, index * table->identifier_size))) {
+			// Verify the identifier now, the stored hash rejects most of the other identifiers without touching them
+			if (table->hashes[index] == key && table->identifier_compare(identifier, OffsetPointer(table->identifiers, index * table->identifier_size))) {
 				return index;
 			}
 		}
+		// A slot closer to its home than we are (or an empty one) means that the identifier would have been placed before it
+		else if (current_distance < distance) {
+			break;
+		}
 		index++;
 	}
 
+	*stop_index = index;
+	*stop_distance = distance;
 	return -1;
 }
 
+size_t FindTableUnmigrated(const HashTable* table, const void* identifier, size_t hash)
+{
+	const HashTableMigration* migration = &table->migration;
+	if (migration->buffer == NULL) {
+		return -1;
+	}
+
+	// The slots before next_slot were moved, the ones after it are untouched and keep the Robin Hood order
+	size_t home = table->map_function(hash, migration->capacity);
+	size_t index = max(home, migration->next_slot);
+	for (size_t distance = index - home + 1; distance <= migration->max_search_length; distance++) {
+		unsigned char current_distance = migration->metadata[index];
+		if (current_distance == distance) {
+			if (migration->hashes[index] == hash
+				&& table->identifier_compare(identifier, OffsetPointer(migration->identifiers, index * table->identifier_size))) {
+				return GetExtendedCapacity(table->capacity) + index;
+			}
+		}
+		else if (current_distance < distance) {
+			break;
+		}
+		index++;
+	}
+	return -1;
+}
+
+/*
+	Searches both the new arrays and the entries of an incremental resize that were not moved yet
+*/
+static size_t FindTableHashed(const HashTable* table, const void* identifier, size_t key)
+{
+	size_t stop_index, stop_distance;
+	size_t index = ProbeTable(table, identifier, key, &stop_index, &stop_distance);
+	if (index == -1 && table->migration.buffer != NULL) {
+		index = FindTableUnmigrated(table, identifier, key);
+	}
+	return index;
+}
+
+size_t FindTable(const HashTable* table, const void* identifier)
+{
+	if (table->capacity == 0) {
+		return -1;
+	}
+	return FindTableHashed(table, identifier, table->hash_function(identifier));
+}
+
+void FindTableBatch(const HashTable* table, const void* identifiers, size_t count, size_t* indices)
+{
+	if (table->capacity == 0) {
+		for (size_t index = 0; index < count; index++) {
+			indices[index] = -1;
+		}
+		return;
+	}
+
+	size_t keys[HASH_TABLE_BATCH_SIZE];
+	for (size_t batch_start = 0; batch_start < count; batch_start += HASH_TABLE_BATCH_SIZE) {
+		size_t batch_count = min(count - batch_start, HASH_TABLE_BATCH_SIZE);
+		const void* batch_identifiers = OffsetPointer(identifiers, batch_start * table->identifier_size);
+
+		for (size_t index = 0; index < batch_count; index++) {
+			keys[index] = table->hash_function(OffsetPointer(batch_identifiers, index * table->identifier_size));
+			size_t home = table->map_function(keys[index], table->capacity);
+			HashTablePrefetch(table->metadata + home);
+			HashTablePrefetch(table->hashes + home);
+			HashTablePrefetch(OffsetPointer(table->identifiers, home * table->identifier_size));
+		}
+		for (size_t index = 0; index < batch_count; index++) {
+			indices[batch_start + index] = FindTableHashed(table, OffsetPointer(batch_identifiers, index * table->identifier_size), keys[index]);
+		}
+	}
+}
+
+size_t FindOrInsertTable(HashTable* table, const void* element, const void* identifier, int* inserted)
+{
+	if (table->capacity == 0) {
+		GrowTable(table, table->grow_function);
+	}
+	MigrateTableSlots(table, table->resize_step);
+
+	size_t key = table->hash_function(identifier);
+	size_t stop_index, stop_distance;
+	size_t index = ProbeTable(table, identifier, key, &stop_index, &stop_distance);
+	if (index == -1 && table->migration.buffer != NULL) {
+		index = FindTableUnmigrated(table, identifier, key);
+	}
+	*inserted = index == -1;
+	if (index != -1) {
+		return index;
+	}
+
+	// The insertion continues from the slot where the search stopped instead of probing again from the home slot
+	if (!FinishTableResizeForKey(table, key) && InsertTableAt(table, element, identifier, key, stop_index, (unsigned char)stop_distance, &index)) {
+		if (!IsTableOverloaded(table)) {
+			return index;
+		}
+		GrowTable(table, table->grow_function);
+	}
+	else if (AddTableHashed(table, element, identifier, key) == -1) {
+		*inserted = 0;
+		return -1;
+	}
+	return FindTableHashed(table, identifier, key);
+}
+
+void* FindOrInsertTablePtr(HashTable* table, const void* element, const void* identifier, int* inserted)
+{
+	size_t index = FindOrInsertTable(table, element, identifier, inserted);
+	return index != -1 ? GetTablePtr(table, index) : NULL;
+}
+
 void* FindTablePtr(const HashTable* table, const void* identifier)
 {
 	size_t index = FindTable(table, identifier);
-	return index == -1 ? NULL : OffsetPointer(table->buffer, index * table->element_size);
+	return index == -1 ? NULL : GetTablePtr(table, index);
 }
 
 void* GetTablePtr(const HashTable* table, size_t index)
 {
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	if (index >= extended_capacity) {
+		// An entry that the incremental resize did not move yet
+		return OffsetPointer(table->migration.buffer, (index - extended_capacity) * table->element_size);
+	}
 	return OffsetPointer(table->buffer, index * table->element_size);
 }
 
 void* GetTableIdentifierPtr(const HashTable* table, size_t index) {
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	if (index >= extended_capacity) {
+		return OffsetPointer(table->migration.identifiers, (index - extended_capacity) * table->identifier_size);
+	}
 	return OffsetPointer(table->identifiers, index * table->identifier_size);
 }
 
 int IsTableElementAt(const HashTable* table, size_t index)
 {
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	if (index >= extended_capacity) {
+		index -= extended_capacity;
+		return index >= table->migration.next_slot && table->migration.metadata[index] != 0;
+	}
 	return table->metadata[index] != 0;
 }
 
 int RemoveTable(HashTable* table, const void* identifier)
 {
+	// The slots are moved before the search, moving them afterwards would invalidate the index
+	MigrateTableSlots(table, table->resize_step);
 	size_t index = FindTable(table, identifier);
 	if (index != -1) {
 		RemoveTableIndex(table, index);
@@ -215,11 +473,52 @@ int RemoveTable(HashTable* table, const void* identifier)
 
 void IterateTable(const HashTable* table, HashTableIterate iterate_function, void* extra_data)
 {
+	if (table->metadata == NULL) {
+		return;
+	}
+
 	size_t extended_capacity = GetExtendedCapacity(table->capacity);
 	for (size_t index = 0; index < extended_capacity; index++) {
 		if (IsTableElementAt(table, index)) {
 			if (iterate_function(GetTablePtr(table, index), GetTableIdentifierPtr(table, index), extra_data)) {
-				break;
+				return;
+			}
+		}
+	}
+
+	const HashTableMigration* migration = &table->migration;
+	if (migration->buffer != NULL) {
+		size_t old_extended_capacity = GetExtendedCapacity(migration->capacity);
+		for (size_t index = migration->next_slot; index < old_extended_capacity; index++) {
+			if (migration->metadata[index] != 0) {
+				void* element = OffsetPointer(migration->buffer, index * table->element_size);
+				void* identifier = OffsetPointer(migration->identifiers, index * table->identifier_size);
+				if (iterate_function(element, identifier, extra_data)) {
+					return;
+				}
+			}
+		}
+	}
+}
+
+void GetTableProbeHistogram(const HashTable* table, size_t* histogram)
+{
+	memset(histogram, 0, sizeof(size_t) * HASH_TABLE_MAX_DISTANCE);
+	if (table->metadata != NULL) {
+		size_t extended_capacity = GetExtendedCapacity(table->capacity);
+		for (size_t index = 0; index < extended_capacity; index++) {
+			if (table->metadata[index] != 0) {
+				histogram[table->metadata[index] - 1]++;
+			}
+		}
+	}
+
+	const HashTableMigration* migration = &table->migration;
+	if (migration->buffer != NULL) {
+		size_t old_extended_capacity = GetExtendedCapacity(migration->capacity);
+		for (size_t index = migration->next_slot; index < old_extended_capacity; index++) {
+			if (migration->metadata[index] != 0) {
+				histogram[migration->metadata[index] - 1]++;
 			}
 		}
 	}
@@ -227,32 +526,52 @@ void IterateTable(const HashTable* table, HashTableIterate iterate_function, voi
 
 void RemoveTableIndex(HashTable* table, size_t index)
 {
+	void* elements = table->buffer;
+	void* identifiers = table->identifiers;
+	size_t* hashes = table->hashes;
+	unsigned char* metadata = table->metadata;
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	if (index >= extended_capacity) {
+		// The backward shift works the same inside the old arrays, it only moves the entries after the index
+		elements = table->migration.buffer;
+		identifiers = table->migration.identifiers;
+		hashes = table->migration.hashes;
+		metadata = table->migration.metadata;
+		index -= extended_capacity;
+	}
+
 	// getting the distance of the next slot;
 	index++;
-	unsigned char distance = GetDistanceIndex(table, index);
+	unsigned char distance = GetDistance(metadata[index]);
 
 	// while we find a slot that is not empty and that is not in its ideal hash position
 	// backward shift the elements
 	while (distance > 1) {
 		distance--;
-		table->metadata[index - 1] = distance;
-		void* destination_value = GetTablePtr(table, index - 1);
-		void* source_value = GetTablePtr(table, index);
+		metadata[index - 1] = distance;
+		void* destination_value = OffsetPointer(elements, (index - 1) * table->element_size);
+		void* source_value = OffsetPointer(elements, index * table->element_size);
 
-		void* destination_identifier = GetTablePtr(table, index - 1);
-		void* source_identifier = GetTablePtr(table, index);
+		void* destination_identifier = OffsetPointer(identifiers, (index - 1) * table->identifier_size);
+		void* source_identifier = OffsetPointer(identifiers, index * table->identifier_size);
 		memcpy(destination_value, source_value, table->element_size);
 		memcpy(destination_identifier, source_identifier, table->identifier_size);
+		hashes[index - 1] = hashes[index];
 		index++;
-		distance = GetDistanceIndex(table, index);
+		distance = GetDistance(metadata[index]);
 	}
-	table->metadata[index - 1] = 0;
+	metadata[index - 1] = 0;
 	table->size--;
+
+	if (table->min_load_factor > 0 && table->capacity / 2 >= table->min_capacity && table->size * 100 < table->capacity * table->min_load_factor) {
+		GrowTableToCapacity(table, table->capacity / 2);
+	}
 }
 
 void ResetTableLengthCounter(HashTable* table) {
 	table->max_search_length = 0;
-	for (size_t index = 0; index < table->capacity; index++) {
+	size_t extended_capacity = GetExtendedCapacity(table->capacity);
+	for (size_t index = 0; index < extended_capacity; index++) {
 		table->max_search_length = max(table->max_search_length, table->metadata[index]);
 	}
 }
@@ -262,21 +581,45 @@ void DestroyTable(const HashTable* table)
 	if (table->buffer != NULL) {
 		free(table->buffer);
 	}
+	if (table->migration.buffer != NULL) {
+		free(table->migration.buffer);
+	}
 }
 
 HashTable CopyTable(const HashTable* table)
 {
 	HashTable new_table = CreateTable(table->capacity, table->element_size, table->identifier_size, table->map_function, table->hash_function, table->identifier_compare);
-	memcpy(new_table.buffer, table->buffer, MemoryOfTable(table->element_size, table->identifier_size, table->capacity));
+	if (table->buffer != NULL) {
+		memcpy(new_table.buffer, table->buffer, MemoryOfTable(table->element_size, table->identifier_size, table->capacity));
+	}
 	new_table.size = table->size;
 	new_table.max_search_length = table->max_search_length;
+	new_table.grow_function = table->grow_function;
+	new_table.max_load_factor = table->max_load_factor;
+	new_table.min_load_factor = table->min_load_factor;
+	new_table.min_capacity = table->min_capacity;
+	new_table.resize_step = table->resize_step;
+
+	// The copy does not inherit a resize in progress, it moves the entries that it did not receive yet right away
+	const HashTableMigration* migration = &table->migration;
+	if (migration->buffer != NULL) {
+		size_t old_table_size = MemoryOfTable(table->element_size, table->identifier_size, migration->capacity);
+		new_table.migration = *migration;
+		new_table.migration.buffer = malloc(old_table_size);
+		memcpy(new_table.migration.buffer, migration->buffer, old_table_size);
+		size_t extended_capacity = GetExtendedCapacity(migration->capacity);
+		new_table.migration.identifiers = OffsetPointer(new_table.migration.buffer, GetIdentifiersOffset(table->element_size, extended_capacity));
+		new_table.migration.hashes = OffsetPointer(new_table.migration.buffer, GetHashesOffset(table->element_size, table->identifier_size, extended_capacity));
+		new_table.migration.metadata = OffsetPointer(new_table.migration.hashes, sizeof(size_t) * extended_capacity);
+		FinishTableResize(&new_table);
+	}
 	return new_table;
 }
 
 size_t MemoryOfTable(size_t element_size, size_t identifier_size, size_t capacity)
 {
-	size_t per_element_size = element_size + identifier_size + sizeof(unsigned char);
-	return GetExtendedCapacity(capacity) * per_element_size;
+	size_t extended_capacity = GetExtendedCapacity(capacity);
+	return GetHashesOffset(element_size, identifier_size, extended_capacity) + (sizeof(size_t) + sizeof(unsigned char)) * extended_capacity;
 }
 
 void GrowTable(HashTable* table, HashTableGrowFunction grow_capacity)
@@ -285,40 +628,189 @@ void GrowTable(HashTable* table, HashTableGrowFunction grow_capacity)
 	GrowTableToCapacity(table, new_capacity);
 }
 
-void GrowTableToCapacity(HashTable* table, size_t capacity)
+/*
+	Moves the occupied slots of the given arrays, from first_slot onwards, into the table. Returns 0 as soon as
+	one of them does not fit
+*/
+static int RehashTableSlots(HashTable* table, const void* elements, const void* identifiers, const size_t* hashes, const unsigned char* metadata, size_t first_slot, size_t capacity)
 {
-	// Allocate a new set of buffers
-	size_t table_size = MemoryOfTable(table->element_size, table->identifier_size, capacity);
-	void* new_buffer = malloc(table_size);
-
-	// Partition the buffer
 	size_t extended_capacity = GetExtendedCapacity(capacity);
+	for (size_t index = first_slot; index < extended_capacity; index++) {
+		if (metadata[index] != 0) {
+			// the stored hash is reused, the hash function is not called again
+			int inserted = InsertTableHome(
+				table,
+				OffsetPointer(elements, index * table->element_size),
+				OffsetPointer(identifiers, index * table->identifier_size),
+				hashes[index]
+			);
+			if (!inserted) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/*
+	Moves all the entries, the ones that an incremental resize did not move yet included, into new arrays of the
+	given capacity. While they do not fit, the capacity grows with the grow function
+*/
+static void RehashTable(HashTable* table, size_t capacity)
+{
+	HashTable old_table = *table;
+	const HashTableMigration* migration = &old_table.migration;
+
+	while (1) {
+		PartitionTable(table, malloc(MemoryOfTable(table->element_size, table->identifier_size, capacity)), capacity);
+		table->capacity = capacity;
+		table->size = 0;
+		table->max_search_length = 0;
+
+		int rehashed = old_table.metadata == NULL
+			|| RehashTableSlots(table, old_table.buffer, old_table.identifiers, old_table.hashes, old_table.metadata, 0, old_table.capacity);
+		if (rehashed && migration->buffer != NULL) {
+			rehashed = RehashTableSlots(table, migration->buffer, migration->identifiers, migration->hashes, migration->metadata, migration->next_slot, migration->capacity);
+		}
+		if (rehashed) {
+			break;
+		}
+		free(table->buffer);
+		capacity = table->grow_function(capacity);
+	}
+
+	if (old_table.buffer != NULL) {
+		free(old_table.buffer);
+	}
+	if (migration->buffer != NULL) {
+		free(migration->buffer);
+	}
+	memset(&table->migration, 0, sizeof(table->migration));
+}
+
+int GrowTableForKey(HashTable* table, size_t key)
+{
+	// The window is looked at with every entry in the current arrays
+	FinishTableResize(table);
+
+	size_t capacity = table->grow_function(table->capacity);
+	size_t home = table->map_function(key, table->capacity);
+	size_t new_home = table->map_function(key, capacity);
+	int any_moved = 0;
+	for (size_t index = home; index < home + HASH_TABLE_MAX_DISTANCE && !any_moved; index++) {
+		if (table->metadata[index] != 0) {
+			size_t entry_home = table->map_function(table->hashes[index], capacity);
+			any_moved = entry_home + HASH_TABLE_MAX_DISTANCE <= new_home || entry_home >= new_home + HASH_TABLE_MAX_DISTANCE;
+		}
+	}
+	if (!any_moved) {
+		return 0;
+	}
+
+	// All at once, the key is inserted right after the growth and it needs the entries in their new slots
+	RehashTable(table, capacity);
+	return 1;
+}
+
+int FinishTableResizeForKey(HashTable* table, size_t key)
+{
+	const HashTableMigration* migration = &table->migration;
+	if (migration->buffer == NULL) {
+		return 0;
+	}
+
+	// With HashTableMapPowerOfTwo, the entries that share the home in the new arrays shared it in the old ones as well
+	size_t home = table->map_function(key, table->capacity);
+	size_t old_home = table->map_function(key, migration->capacity);
+	size_t sharing_count = 0;
+	for (size_t offset = 0; offset < HASH_TABLE_MAX_DISTANCE; offset++) {
+		sharing_count += table->metadata[home + offset] != 0 && table->map_function(table->hashes[home + offset], table->capacity) == home;
+		size_t old_index = old_home + offset;
+		sharing_count += old_index >= migration->next_slot && migration->metadata[old_index] != 0
+			&& table->map_function(migration->hashes[old_index], table->capacity) == home;
+	}
+	if (sharing_count < HASH_TABLE_MAX_DISTANCE) {
+		return 0;
+	}
+	FinishTableResize(table);
+	return 1;
+}
 
-	void* new_elements = new_buffer;
-	void* new_identifiers = OffsetPointer(new_buffer, table->element_size * extended_capacity);
-	void* new_metadata = OffsetPointer(new_identifiers, table->identifier_size * extended_capacity);
-	memset(new_metadata, 0, sizeof(unsigned char) * extended_capacity);
+void GrowTableToCapacity(HashTable* table, size_t capacity)
+{
+	if (table->metadata == NULL || table->resize_step == 0 || table->size == 0) {
+		RehashTable(table, capacity);
+		return;
+	}
 
-	void* old_elements = table->buffer;
-	void* old_identifiers = table->identifiers;
-	unsigned char* old_metadata = table->metadata;
+	// Only one set of old arrays is kept, a resize that is still in progress is completed first
+	FinishTableResize(table);
 
-	size_t old_extended_capacity = GetExtendedCapacity(table->capacity);
+	HashTableMigration* migration = &table->migration;
+	migration->buffer = table->buffer;
+	migration->identifiers = table->identifiers;
+	migration->hashes = table->hashes;
+	migration->metadata = table->metadata;
+	migration->capacity = table->capacity;
+	migration->max_search_length = table->max_search_length;
+	migration->next_slot = 0;
 
-	// Set the new values
+	PartitionTable(table, malloc(MemoryOfTable(table->element_size, table->identifier_size, capacity)), capacity);
 	table->capacity = capacity;
-	table->buffer = new_elements;
-	table->identifiers = new_identifiers;
-	table->metadata = new_metadata;
 	table->max_search_length = 0;
-	table->size = 0;
+}
+
+void SetTableResizePolicy(HashTable* table, HashTableGrowFunction grow_function, size_t max_load_factor, size_t min_load_factor, size_t min_capacity)
+{
+	table->grow_function = grow_function;
+	table->max_load_factor = max_load_factor;
+	table->min_load_factor = min_load_factor;
+	table->min_capacity = min_capacity;
+}
 
-	if (old_metadata != NULL) {
-		// Now for each element, rehash it and insert it into the table
-		for (size_t index = 0; index < old_extended_capacity; index++) {
-			if (old_metadata[index] != 0) {
-				AddTable(table, OffsetPointer(old_elements, index * table->element_size), OffsetPointer(old_identifiers, index * table->identifier_size));
+void SetTableIncrementalResize(HashTable* table, size_t step)
+{
+	table->resize_step = step;
+	if (step == 0) {
+		FinishTableResize(table);
+	}
+}
+
+void MigrateTableSlots(HashTable* table, size_t slot_count)
+{
+	HashTableMigration* migration = &table->migration;
+	if (migration->buffer == NULL) {
+		return;
+	}
+
+	size_t old_extended_capacity = GetExtendedCapacity(migration->capacity);
+	size_t end_slot = migration->next_slot + min(slot_count, old_extended_capacity - migration->next_slot);
+	for (; migration->next_slot < end_slot; migration->next_slot++) {
+		size_t slot = migration->next_slot;
+		if (migration->metadata[slot] != 0) {
+			int inserted = InsertTableHome(
+				table,
+				OffsetPointer(migration->buffer, slot * table->element_size),
+				OffsetPointer(migration->identifiers, slot * table->identifier_size),
+				migration->hashes[slot]
+			);
+			if (!inserted) {
+				// The new arrays are too small as well, everything is moved at once into bigger ones
+				RehashTable(table, table->grow_function(table->capacity));
+				return;
 			}
+			// The size already counted the entry, the insertion counted it again
+			table->size--;
 		}
 	}
+
+	if (migration->next_slot == old_extended_capacity) {
+		free(migration->buffer);
+		memset(migration, 0, sizeof(*migration));
+	}
+}
+
+void FinishTableResize(HashTable* table)
+{
+	MigrateTableSlots(table, -1);
 }
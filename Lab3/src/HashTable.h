@@ -13,7 +13,9 @@ typedef int (*HashTableIdentifierCompare)(const void* first, const void* second)
 typedef size_t (*HashTableMapFunction)(size_t index, size_t capacity);
 
 /*
-	This function converts an identifier into an integer value
+	This function converts an identifier into an integer value. At most HASH_TABLE_MAX_DISTANCE identifiers of
+	a table can share the same value (the same low bits, for HashTableMapPowerOfTwo), the insertion of another
+	one fails without growing the table
 */
 typedef size_t (*HashTableHashFunction)(const void* identifier);
 
@@ -55,18 +57,48 @@ size_t HashTableHashInteger(const void* identifier);
 size_t HashTableHashSizeT(const void* identifier);
 
 /*
-	Default hash table grow function which returns the current capacity (assumed to be a power of two) multiplied by 2
+	Default hash table grow function which returns the current capacity (assumed to be a power of two) multiplied by 2,
+	or HASH_TABLE_MIN_CAPACITY for an empty table
 */
 size_t HashTableGrowPowerOfTwo(size_t capacity);
 
 /*
-	The maximum load factor of the table after which a grow is required
+	Rounds the capacity up to a power of two, as the tables that use HashTableMapPowerOfTwo need. 0 stays 0
+*/
+size_t HashTablePowerOfTwoCapacity(size_t capacity);
+
+/*
+	The default load factors (in percent) of the resize policy. The table grows when an insertion takes it above
+	the maximum and shrinks when a removal takes it below the minimum. Growing doubles the capacity and shrinking
+	halves it, so a table that was just resized sits at 45% or 40%, far from both thresholds
 */
 #define HASH_TABLE_MAX_LOAD_FACTOR 90
+#define HASH_TABLE_MIN_LOAD_FACTOR 20
 
+/*
+	The capacity of a table that grows from 0 and the smallest one that a table shrinks to by default
+*/
+#define HASH_TABLE_MIN_CAPACITY 16
+
+/*
+	The arrays that an incremental resize moves the entries out of. They have the same layout as the arrays of the table
+*/
 typedef struct {
 	void* buffer;
 	void* identifiers;
+	size_t* hashes;
+	unsigned char* metadata;
+	size_t capacity;
+	size_t max_search_length;
+	// The slots before it were already moved into the new arrays
+	size_t next_slot;
+} HashTableMigration;
+
+typedef struct {
+	void* buffer;
+	void* identifiers;
+	// The full hash of every identifier, compared before the identifiers themselves and reused when growing
+	size_t* hashes;
 	unsigned char* metadata;
 	size_t max_search_length;
 	size_t capacity;
@@ -77,11 +109,25 @@ typedef struct {
 	HashTableIdentifierCompare identifier_compare;
 	HashTableMapFunction map_function;
 	HashTableHashFunction hash_function;
+
+	// The resize policy, see SetTableResizePolicy
+	HashTableGrowFunction grow_function;
+	size_t max_load_factor;
+	size_t min_load_factor;
+	size_t min_capacity;
+
+	// How many old slots every insertion or removal moves while an incremental resize is in progress,
+	// 0 if the table is rehashed all at once when it grows
+	size_t resize_step;
+	// The buffer is NULL when no incremental resize is in progress
+	HashTableMigration migration;
 } HashTable;
 
 /*
 	Initializes a hash table. Capacity is the initial capacity, element_size the byte size of the elements,
-	identifier_size the byte size of the identifiers (keys), and the hash table functions
+	identifier_size the byte size of the identifiers (keys), and the hash table functions.
+	The table resizes itself with HashTableGrowPowerOfTwo and the default load factors, and it does not shrink
+	below the initial capacity (or HASH_TABLE_MIN_CAPACITY)
 */
 HashTable CreateTable(
 	size_t capacity,
@@ -93,14 +139,19 @@ HashTable CreateTable(
 );
 
 /*
-	Adds the element in the table by hashing it. 
-	Returns 1 if the table needs a resize, else 0
+	Adds the element in the table by hashing it. The table grows before the insertion if the element cannot be placed
+	within HASH_TABLE_MAX_DISTANCE slots of its home, and after it if the load factor goes above the maximum.
+	Returns 1 if the table was resized (the indices and the pointers into it are no longer valid), else 0.
+	Returns -1 if the element was not added, because growing does not make room for it (more than
+	HASH_TABLE_MAX_DISTANCE identifiers share its hash). The table can have been resized then as well
 */
 int AddTable(HashTable* table, const void* element, const void* identifier);
 
 /*
-	Searches for an identifier and returns its index inside the table if found, 
-	else -1 if the identifier cannot be located
+	Searches for an identifier and returns its index inside the table if found,
+	else -1 if the identifier cannot be located.
+	When SSE2 or AVX2 is available, the metadata is probed 16 or 32 slots at a time and the identifiers are
+	compared only for the slots with the expected distance. Define HASH_TABLE_SCALAR_PROBING to probe one slot at a time
 */
 size_t FindTable(const HashTable* table, const void* identifier);
 
@@ -110,6 +161,28 @@ size_t FindTable(const HashTable* table, const void* identifier);
 */
 void* FindTablePtr(const HashTable* table, const void* identifier);
 
+/*
+	Searches for count identifiers, stored one after the other, and fills indices with the index of each of them
+	or -1, like FindTable. The identifiers are hashed and their home slots are prefetched in groups of
+	HASH_TABLE_BATCH_SIZE before any of them is probed, such that the cache misses of a big table overlap
+	instead of being waited for one after the other
+*/
+void FindTableBatch(const HashTable* table, const void* identifiers, size_t count, size_t* indices);
+
+/*
+	Searches for an identifier and adds it with the given element if it cannot be located. The identifier is hashed
+	and probed a single time, the insertion continues from the slot where the search stopped. Inserted is set to 1
+	if the element was added, else to 0. The table grows like for AddTable (or if it has no capacity yet).
+	Returns the index of the existing or of the added entry, valid after the grow, or -1 if the element
+	could not be added like for AddTable
+*/
+size_t FindOrInsertTable(HashTable* table, const void* element, const void* identifier, int* inserted);
+
+/*
+	The same as the other find or insert, except that it returns a pointer to the element, NULL if it could not be added
+*/
+void* FindOrInsertTablePtr(HashTable* table, const void* element, const void* identifier, int* inserted);
+
 /*
 	Returns a pointer to an element given by its index. Does not do bounds checking.
 */
@@ -136,8 +209,16 @@ int RemoveTable(HashTable* table, const void* identifier);
 */
 void IterateTable(const HashTable* table, HashTableIterate iterate_function, void* extra_data);
 
+/*
+	Fills histogram (HASH_TABLE_MAX_DISTANCE counters) with how many entries a search finds after probing 1, 2, ...
+	slots, which shows how evenly the hash function spreads the identifiers. The entries that an incremental resize
+	did not move yet are counted with their distance in the old arrays
+*/
+void GetTableProbeHistogram(const HashTable* table, size_t* histogram);
+
 /*
 	Removes an entry from the table given by the index. It does not do bounds checking for the index.
+	The table shrinks if the load factor falls below the minimum, the other indices are then no longer valid
 */
 void RemoveTableIndex(HashTable* table, size_t index);
 
@@ -163,13 +244,69 @@ HashTable CopyTable(const HashTable* table);
 size_t MemoryOfTable(size_t element_size, size_t identifier_size, size_t capacity);
 
 /*
-	Grows the table to the next available capacity.
+	Grows the table to the next available capacity. The table grows by itself as needed, this is meant for
+	reserving space ahead of many insertions
 */
 void GrowTable(HashTable* table, HashTableGrowFunction grow_function);
 
+/*
+	Grows the table for a key that does not fit in HASH_TABLE_MAX_DISTANCE slots of its home, used by the insertions.
+	An incremental resize in progress is completed first and the table is rehashed at once. Returns 0 without growing
+	if none of the entries in the HASH_TABLE_MAX_DISTANCE slots from the home of the key would move away from it at
+	the next capacity (their hashes are the same as the one of the key, for example), since the key would not fit then
+	either and the table would keep growing until the memory runs out
+*/
+int GrowTableForKey(HashTable* table, size_t key);
+
+/*
+	Completes an incremental resize in progress before the insertion of the key, if HASH_TABLE_MAX_DISTANCE entries
+	share its home with the ones that were not moved yet counted as well. Else the key could be placed in the new
+	arrays and those entries would no longer fit once they are moved. Returns 1 if the resize was completed
+*/
+int FinishTableResizeForKey(HashTable* table, size_t key);
+
 /*
 	Grows the table to a certain capacity value. The capacity must respect any capacity conditions. (example
-	for power of two size it must be a power of two)
+	for power of two size it must be a power of two). A smaller capacity shrinks the table. If the entries
+	do not fit in HASH_TABLE_MAX_DISTANCE slots of their homes, the capacity keeps growing with the grow function
+	of the table. With an incremental resize, only the new arrays are allocated here and the entries are moved later on
 */
 void GrowTableToCapacity(HashTable* table, size_t capacity);
 
+/*
+	Replaces the resize policy of the table. The table grows with grow_function when the load factor (in percent)
+	goes above max_load_factor and its capacity is halved when the load factor falls below min_load_factor, but not
+	below min_capacity. A min_load_factor of 0 turns shrinking off. For the two thresholds to have hysteresis with
+	a grow function that doubles the capacity, max_load_factor / 2 and 2 * min_load_factor must both lie between them
+*/
+void SetTableResizePolicy(HashTable* table, HashTableGrowFunction grow_function, size_t max_load_factor, size_t min_load_factor, size_t min_capacity);
+
+/*
+	With a step bigger than 0, growing the table no longer rehashes all the entries at once. The old arrays are
+	kept next to the new ones and every insertion or removal (AddTable, FindOrInsertTable, RemoveTable) moves the
+	next step slots of the old arrays into the new ones. The searches look into both arrays while the resize is in
+	progress, they do not move entries since they do not modify the table. The indices of the entries that were
+	not moved yet are past the extended capacity of the table, they are valid only for GetTablePtr,
+	GetTableIdentifierPtr, IsTableElementAt and RemoveTableIndex until the next modification.
+	A step of 0 completes the resize in progress and turns the mode off
+*/
+void SetTableIncrementalResize(HashTable* table, size_t step);
+
+/*
+	Moves the next slot_count slots of an incremental resize into the new arrays. Can be called when the table
+	is idle to finish the resize sooner
+*/
+void MigrateTableSlots(HashTable* table, size_t slot_count);
+
+/*
+	Moves all the remaining entries of an incremental resize
+*/
+void FinishTableResize(HashTable* table);
+
+/*
+	Searches for an identifier, with its hash already computed, only between the entries that an incremental resize
+	did not move yet. Returns the index of the entry (past the extended capacity) or -1. It is used by the typed
+	tables after a search of the new arrays fails
+*/
+size_t FindTableUnmigrated(const HashTable* table, const void* identifier, size_t hash);
+
@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#ifdef _MSC_VER
+// _BitScanForward
+#include <intrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+/*
+	The helpers for probing the metadata of a HashTable, shared by HashTable.c and the typed tables
+	of TypedHashTable.h
+*/
+
+/*
+	The metadata is followed by this many padding slots, a probe never wraps around to the start of the table
+*/
+#define HASH_TABLE_MAX_DISTANCE 32
+
+/*
+	How many identifiers a batched search hashes and prefetches before it starts probing them
+*/
+#define HASH_TABLE_BATCH_SIZE 16
+
+/*
+	Asks for the cache line of the address ahead of its use. It is only a hint, it does nothing where it is not supported
+*/
+static inline void HashTablePrefetch(const void* address) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch((const char*)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address);
+#endif
+}
+
+/*
+	Returns 1 if a Robin Hood insertion that starts at index with the given distance stays inside the padding
+	and keeps every distance at most HASH_TABLE_MAX_DISTANCE, else 0. Every cluster is ordered by the home slots,
+	so the insertion moves each entry between its slot and the next empty one by exactly one slot
+*/
+static inline int HashTableInsertionFits(const unsigned char* metadata, size_t extended_capacity, size_t index, size_t distance) {
+	while (metadata[index] > distance) {
+		distance++;
+		index++;
+		if (index == extended_capacity) {
+			return 0;
+		}
+	}
+	if (distance > HASH_TABLE_MAX_DISTANCE) {
+		return 0;
+	}
+	while (metadata[index] != 0) {
+		if (metadata[index] == HASH_TABLE_MAX_DISTANCE) {
+			return 0;
+		}
+		index++;
+		if (index == extended_capacity) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#ifndef HASH_TABLE_SCALAR_PROBING
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HASH_TABLE_PROBE_GROUP 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_TABLE_PROBE_GROUP 16
+#endif
+#endif
+
+#ifdef HASH_TABLE_PROBE_GROUP
+
+/*
+	Compares a group of metadata bytes against the distances that a probe starting with first_distance expects
+	at each of them. Returns a bit for each slot that has exactly the expected distance and fills stop_mask with
+	a bit for each slot that has a smaller one (an empty slot included)
+*/
+static inline uint32_t HashTableMatchDistanceGroup(const unsigned char* metadata, unsigned char first_distance, uint32_t* stop_mask) {
+#if HASH_TABLE_PROBE_GROUP == 32
+	__m256i offsets = _mm256_setr_epi8(
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+		16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+	);
+	__m256i expected = _mm256_add_epi8(_mm256_set1_epi8((char)first_distance), offsets);
+	__m256i distances = _mm256_loadu_si256((const __m256i*)metadata);
+	// The distances are unsigned, max(distance, expected) == distance exactly when distance >= expected
+	*stop_mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(distances, expected), distances));
+	return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(distances, expected));
+#else
+	__m128i offsets = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i expected = _mm_add_epi8(_mm_set1_epi8((char)first_distance), offsets);
+	__m128i distances = _mm_loadu_si128((const __m128i*)metadata);
+	// The distances are unsigned, max(distance, expected) == distance exactly when distance >= expected
+	*stop_mask = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(distances, expected), distances)) & 0xFFFF;
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(distances, expected));
+#endif
+}
+
+/*
+	Limits the matches of a group to the probe length and to the slots before the first poorer one,
+	which is where the Robin Hood invariant stops the search
+*/
+static inline uint32_t HashTableLimitGroupMatches(uint32_t match_mask, uint32_t stop_mask, size_t remaining) {
+	if (remaining < HASH_TABLE_PROBE_GROUP) {
+		match_mask &= ((uint32_t)1 << remaining) - 1;
+	}
+	if (stop_mask != 0) {
+		match_mask &= (stop_mask & (0 - stop_mask)) - 1;
+	}
+	return match_mask;
+}
+
+#endif
+
+static inline size_t HashTableLowestMatch(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return (size_t)__builtin_ctz(mask);
+#endif
+}
@@ -0,0 +1,221 @@
+#include "LazyAutomata.h"
+#include "BitUtilities.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	The identifier of a cached state in the state index
+*/
+typedef struct {
+	const uint64_t* words;
+	size_t word_count;
+} LazyStateSet;
+
+static size_t LazyStateSetHash(const void* identifier) {
+	const LazyStateSet* set = identifier;
+	// A multiplication only carries the bits upwards, the high half is folded back after every word.
+	// Without it, the sets that differ only in the high bit of a word get the same hash
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t index = 0; index < set->word_count; index++) {
+		hash ^= set->words[index];
+		hash *= 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 32;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	return (size_t)hash;
+}
+
+static int LazyStateSetCompare(const void* first, const void* second) {
+	const LazyStateSet* first_set = first;
+	const LazyStateSet* second_set = second;
+	return memcmp(first_set->words, second_set->words, sizeof(uint64_t) * first_set->word_count) == 0;
+}
+
+static size_t LazyStateIndexCapacity(size_t max_state_count) {
+	size_t capacity = 16;
+	while (capacity * HASH_TABLE_MAX_LOAD_FACTOR / 100 <= max_state_count) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+/*
+	The set must not be cached already and there must be room for it
+*/
+static unsigned int AddLazyState(LazyAutomata* automata, const uint64_t* set) {
+	size_t word_count = automata->nfa.word_count;
+	size_t class_count = automata->nfa.class_count;
+	size_t state = automata->state_count++;
+
+	uint64_t* state_set = automata->state_sets + state * word_count;
+	memcpy(state_set, set, sizeof(uint64_t) * word_count);
+	size_t accept_label = DENSE_AUTOMATA_NO_LABEL;
+	for (size_t word_index = 0; word_index < word_count; word_index++) {
+		uint64_t word = state_set[word_index] & automata->nfa.accepting_states[word_index];
+		while (word != 0) {
+			accept_label = min(accept_label, automata->nfa_accept_labels[word_index * 64 + LowestSetBit(word)]);
+			word &= word - 1;
+		}
+	}
+	automata->accept_labels[state] = accept_label;
+
+	// The dead state goes only into itself
+	unsigned int unknown_state = state == DENSE_AUTOMATA_DEAD_STATE ? DENSE_AUTOMATA_DEAD_STATE : LAZY_AUTOMATA_UNKNOWN_STATE;
+	unsigned int* row = automata->transitions + state * class_count;
+	for (size_t class_index = 0; class_index < class_count; class_index++) {
+		row[class_index] = unknown_state;
+	}
+
+	LazyStateSet identifier = { state_set, word_count };
+	unsigned int state_index = (unsigned int)state;
+	AddTable(&automata->state_indices, &state_index, &identifier);
+	return state_index;
+}
+
+static unsigned int FindOrAddLazyState(LazyAutomata* automata, const uint64_t* set) {
+	LazyStateSet identifier = { set, automata->nfa.word_count };
+	const unsigned int* state = FindTablePtr(&automata->state_indices, &identifier);
+	return state != NULL ? *state : AddLazyState(automata, set);
+}
+
+/*
+	Drops every cached state. The dead state and the initial state are cached again right away
+*/
+static void FlushLazyAutomata(LazyAutomata* automata) {
+	size_t capacity = automata->state_indices.capacity;
+	DestroyTable(&automata->state_indices);
+	automata->state_indices = CreateTable(capacity, sizeof(unsigned int), sizeof(LazyStateSet), HashTableMapPowerOfTwo, LazyStateSetHash, LazyStateSetCompare);
+	automata->state_count = 0;
+
+	AddLazyState(automata, automata->dead_set);
+	automata->initial_state = FindOrAddLazyState(automata, automata->nfa.initial_states);
+}
+
+void CreateLazyAutomata(const NFA* nfa, size_t cache_size, LazyAutomata* automata)
+{
+	CreateBitParallelAutomata(nfa, &automata->nfa);
+	size_t word_count = automata->nfa.word_count;
+	size_t class_count = automata->nfa.class_count;
+
+	automata->nfa_accept_labels = malloc(sizeof(size_t) * nfa->states.size);
+	for (size_t state = 0; state < nfa->states.size; state++) {
+		const NFAState* nfa_state = GetElement(nfa->states, state);
+		automata->nfa_accept_labels[state] = nfa_state->accept_label;
+	}
+
+	// Every cached state takes its set, its row of transitions, its label and about two slots in the index
+	size_t state_byte_size = sizeof(uint64_t) * word_count + sizeof(unsigned int) * class_count + sizeof(size_t)
+		+ 2 * (sizeof(unsigned int) + sizeof(LazyStateSet) + sizeof(size_t) + sizeof(unsigned char));
+	automata->max_state_count = max(cache_size / state_byte_size, LAZY_AUTOMATA_MIN_CACHED_STATES);
+	automata->state_sets = malloc(sizeof(uint64_t) * word_count * automata->max_state_count);
+	automata->accept_labels = malloc(sizeof(size_t) * automata->max_state_count);
+	automata->transitions = malloc(sizeof(unsigned int) * class_count * automata->max_state_count);
+	automata->next_set = malloc(sizeof(uint64_t) * word_count);
+	automata->dead_set = calloc(word_count, sizeof(uint64_t));
+	automata->state_indices = CreateTable(
+		LazyStateIndexCapacity(automata->max_state_count),
+		sizeof(unsigned int),
+		sizeof(LazyStateSet),
+		HashTableMapPowerOfTwo,
+		LazyStateSetHash,
+		LazyStateSetCompare
+	);
+	automata->miss_count = 0;
+	automata->flush_count = 0;
+	FlushLazyAutomata(automata);
+}
+
+/*
+	Computes a transition that is not cached yet
+*/
+static unsigned int LazyAutomataComputeStep(LazyAutomata* automata, unsigned int state, unsigned char terminal) {
+	size_t word_count = automata->nfa.word_count;
+	automata->miss_count++;
+	BitParallelAutomataStep(&automata->nfa, automata->state_sets + (size_t)state * word_count, terminal, automata->next_set);
+
+	LazyStateSet identifier = { automata->next_set, word_count };
+	const unsigned int* cached_state = FindTablePtr(&automata->state_indices, &identifier);
+	if (cached_state != NULL) {
+		automata->transitions[(size_t)state * automata->nfa.class_count + automata->nfa.byte_classes[terminal]] = *cached_state;
+		return *cached_state;
+	}
+
+	if (automata->state_count == automata->max_state_count) {
+		// The current state is dropped as well, the transition cannot be recorded
+		automata->flush_count++;
+		FlushLazyAutomata(automata);
+		return FindOrAddLazyState(automata, automata->next_set);
+	}
+
+	unsigned int next_state = AddLazyState(automata, automata->next_set);
+	automata->transitions[(size_t)state * automata->nfa.class_count + automata->nfa.byte_classes[terminal]] = next_state;
+	return next_state;
+}
+
+unsigned int LazyAutomataStep(LazyAutomata* automata, unsigned int state, unsigned char terminal)
+{
+	unsigned int next_state = automata->transitions[(size_t)state * automata->nfa.class_count + automata->nfa.byte_classes[terminal]];
+	if (next_state == LAZY_AUTOMATA_UNKNOWN_STATE) {
+		next_state = LazyAutomataComputeStep(automata, state, terminal);
+	}
+	return next_state;
+}
+
+bool LazyAutomataIsAccepting(const LazyAutomata* automata, unsigned int state)
+{
+	return automata->accept_labels[state] != DENSE_AUTOMATA_NO_LABEL;
+}
+
+size_t LazyAutomataRun(LazyAutomata* automata, string sequence)
+{
+	const unsigned char* byte_classes = automata->nfa.byte_classes;
+	size_t class_count = automata->nfa.class_count;
+	unsigned int state = automata->initial_state;
+	for (size_t index = 0; index < sequence.size && state != DENSE_AUTOMATA_DEAD_STATE; index++) {
+		unsigned char terminal = sequence.characters[index];
+		unsigned int next_state = automata->transitions[(size_t)state * class_count + byte_classes[terminal]];
+		if (next_state == LAZY_AUTOMATA_UNKNOWN_STATE) {
+			next_state = LazyAutomataComputeStep(automata, state, terminal);
+		}
+		state = next_state;
+	}
+	return automata->accept_labels[state];
+}
+
+bool LazyAutomataAccepts(LazyAutomata* automata, string sequence)
+{
+	return LazyAutomataRun(automata, sequence) != DENSE_AUTOMATA_NO_LABEL;
+}
+
+size_t LazyAutomataLongestMatch(LazyAutomata* automata, string sequence)
+{
+	unsigned int state = automata->initial_state;
+	size_t longest_match = LazyAutomataIsAccepting(automata, state) ? 0 : DENSE_AUTOMATA_NO_MATCH;
+	for (size_t index = 0; index < sequence.size; index++) {
+		state = LazyAutomataStep(automata, state, sequence.characters[index]);
+		if (state == DENSE_AUTOMATA_DEAD_STATE) {
+			break;
+		}
+		if (LazyAutomataIsAccepting(automata, state)) {
+			longest_match = index + 1;
+		}
+	}
+	return longest_match;
+}
+
+void DestroyLazyAutomata(LazyAutomata* automata)
+{
+	if (automata->state_sets != NULL) {
+		DestroyBitParallelAutomata(&automata->nfa);
+		free(automata->nfa_accept_labels);
+		free(automata->state_sets);
+		free(automata->accept_labels);
+		free(automata->transitions);
+		free(automata->next_set);
+		free(automata->dead_set);
+		DestroyTable(&automata->state_indices);
+	}
+	memset(automata, 0, sizeof(*automata));
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "DenseAutomata.h"
+#include "BitParallelAutomata.h"
+#include "HashTable.h"
+
+/*
+	The transitions of the cached states that were not taken yet
+*/
+#define LAZY_AUTOMATA_UNKNOWN_STATE ((unsigned int)-1)
+
+/*
+	The default number of bytes that the state cache can use
+*/
+#define LAZY_AUTOMATA_DEFAULT_CACHE_SIZE (8 * 1024 * 1024)
+
+/*
+	The cache always has room for at least this many states, whatever its byte size
+*/
+#define LAZY_AUTOMATA_MIN_CACHED_STATES 16
+
+/*
+	Builds the deterministic automata while it runs, instead of up front. A deterministic state is a set of
+	nondeterministic states and it is created the first time that the input reaches it. Its transitions are
+	filled in the first time they are taken, with a step of the bit parallel simulation, and after that they
+	are a table lookup like in the dense automata. The states live in a cache with a fixed capacity, when it
+	is full it is cleared and the states are built again as the input reaches them. The dead state is at
+	index 0 and it is never cleared, like in the dense automata.
+	Running the automata modifies the cache, a single automata must not be run from multiple threads at the same time
+*/
+typedef struct {
+	// Computes the transitions that are not cached
+	BitParallelAutomata nfa;
+	// The accept label of every nondeterministic state
+	size_t* nfa_accept_labels;
+	size_t max_state_count;
+	size_t state_count;
+	// The nondeterministic states of every cached state, nfa.word_count words each
+	uint64_t* state_sets;
+	// The accept label of every cached state, the smallest one of its nondeterministic states
+	size_t* accept_labels;
+	// state_count rows of nfa.class_count entries, LAZY_AUTOMATA_UNKNOWN_STATE for the ones not taken yet
+	unsigned int* transitions;
+	// Identifier is LazyStateSet, element is unsigned int, the index of the cached state
+	HashTable state_indices;
+	unsigned int initial_state;
+	// The set that a transition is computed into before it is looked up
+	uint64_t* next_set;
+	// The empty set, the dead state is cached again from it after every flush
+	uint64_t* dead_set;
+	// How many transitions had to be computed and how many times the cache was cleared
+	size_t miss_count;
+	size_t flush_count;
+} LazyAutomata;
+
+/*
+	The cache_size is the number of bytes that the cached states can use. The nfa is not referenced afterwards
+*/
+void CreateLazyAutomata(const NFA* nfa, size_t cache_size, LazyAutomata* automata);
+
+/*
+	A single transition, it is computed and cached if it was not taken before. A cached state that is not
+	the dead state becomes invalid when the cache is cleared, which can happen on any step
+*/
+unsigned int LazyAutomataStep(LazyAutomata* automata, unsigned int state, unsigned char terminal);
+
+bool LazyAutomataIsAccepting(const LazyAutomata* automata, unsigned int state);
+
+/*
+	Runs the automata over the whole sequence and returns the accept label of the state it stops in.
+	It stops early if the dead state is reached
+*/
+size_t LazyAutomataRun(LazyAutomata* automata, string sequence);
+
+/*
+	Runs the automata over the whole sequence and returns true if it stops in an accepting state
+*/
+bool LazyAutomataAccepts(LazyAutomata* automata, string sequence);
+
+/*
+	Returns the length of the longest prefix of the sequence that is accepted or DENSE_AUTOMATA_NO_MATCH
+*/
+size_t LazyAutomataLongestMatch(LazyAutomata* automata, string sequence);
+
+void DestroyLazyAutomata(LazyAutomata* automata);
@@ -0,0 +1,370 @@
+#include "LexerCache.h"
+#include "FileMapping.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#define LEXER_CACHE_HASH_OFFSET 0xcbf29ce484222325ull
+#define LEXER_CACHE_HASH_PRIME 0x100000001b3ull
+
+// Every section of the payload starts at a multiple of this
+#define LEXER_CACHE_ALIGNMENT sizeof(uint64_t)
+
+static size_t AlignCacheSize(size_t size) {
+	return (size + LEXER_CACHE_ALIGNMENT - 1) & ~(LEXER_CACHE_ALIGNMENT - 1);
+}
+
+// The size must be a multiple of 8
+static uint64_t HashCacheWords(uint64_t hash, const void* data, size_t size) {
+	const char* bytes = data;
+	for (size_t index = 0; index < size; index += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes + index, sizeof(word));
+		hash = (hash ^ word) * LEXER_CACHE_HASH_PRIME;
+	}
+	return hash;
+}
+
+bool HashLexerInputs(const char* const* paths, size_t path_count, uint64_t* input_hash)
+{
+	uint64_t hash = LEXER_CACHE_HASH_OFFSET;
+	for (size_t index = 0; index < path_count; index++) {
+		MappedFile file;
+		if (!MapFile(paths[index], &file)) {
+			return false;
+		}
+		for (size_t subindex = 0; subindex < file.contents.size; subindex++) {
+			hash = (hash ^ (unsigned char)file.contents.characters[subindex]) * LEXER_CACHE_HASH_PRIME;
+		}
+		// Separates the files, such that moving bytes from one file into the next changes the hash
+		hash = (hash ^ file.contents.size) * LEXER_CACHE_HASH_PRIME;
+		UnmapFile(&file);
+	}
+	*input_hash = hash;
+	return true;
+}
+
+typedef struct {
+	FILE* file;
+	uint64_t checksum;
+	uint64_t size;
+	bool failed;
+} CacheWriter;
+
+// Pads the bytes with zeroes up to the alignment
+static void WriteCacheBytes(CacheWriter* writer, const void* data, size_t size) {
+	size_t aligned_size = AlignCacheSize(size);
+	size_t whole_size = size - size % LEXER_CACHE_ALIGNMENT;
+	if (fwrite(data, 1, size, writer->file) != size) {
+		writer->failed = true;
+	}
+	writer->checksum = HashCacheWords(writer->checksum, data, whole_size);
+
+	if (aligned_size != size) {
+		uint64_t last_word = 0;
+		memcpy(&last_word, (const char*)data + whole_size, size - whole_size);
+		size_t padding_size = aligned_size - size;
+		if (fwrite((const char*)&last_word + (size - whole_size), 1, padding_size, writer->file) != padding_size) {
+			writer->failed = true;
+		}
+		writer->checksum = HashCacheWords(writer->checksum, &last_word, sizeof(last_word));
+	}
+	writer->size += aligned_size;
+}
+
+static void WriteCacheCount(CacheWriter* writer, uint64_t count) {
+	WriteCacheBytes(writer, &count, sizeof(count));
+}
+
+static void WriteCacheStrings(CacheWriter* writer, ResizableStream strings) {
+	WriteCacheCount(writer, strings.size);
+	for (size_t index = 0; index < strings.size; index++) {
+		const string* _string = GetElement(strings, index);
+		WriteCacheCount(writer, _string->size);
+		// The null terminator is kept, such that the strings can be printed straight from the mapping
+		WriteCacheBytes(writer, _string->characters, _string->size + 1);
+	}
+}
+
+static void WriteCacheAutomata(CacheWriter* writer, const DenseAutomata* dense_automata) {
+	WriteCacheCount(writer, dense_automata->state_count);
+	WriteCacheCount(writer, dense_automata->initial_state);
+	WriteCacheCount(writer, dense_automata->class_count);
+	WriteCacheBytes(writer, dense_automata->byte_classes, sizeof(dense_automata->byte_classes));
+	WriteCacheBytes(writer, dense_automata->transitions, sizeof(unsigned int) * dense_automata->class_count * dense_automata->state_count);
+	WriteCacheBytes(writer, dense_automata->accept_labels, sizeof(size_t) * dense_automata->state_count);
+	WriteCacheBytes(writer, dense_automata->accepting_states, sizeof(uint64_t) * (dense_automata->state_count / 64 + 1));
+}
+
+#ifdef _WIN32
+
+static unsigned long GetCacheWriterId() {
+	return (unsigned long)_getpid();
+}
+
+// Replaces the destination in one step, readers see either the old file or the new one
+static bool ReplaceCacheFile(const char* source_path, const char* destination_path) {
+	return MoveFileExA(source_path, destination_path, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+static unsigned long GetCacheWriterId() {
+	return (unsigned long)getpid();
+}
+
+// Replaces the destination in one step, readers see either the old file or the new one
+static bool ReplaceCacheFile(const char* source_path, const char* destination_path) {
+	return rename(source_path, destination_path) == 0;
+}
+
+#endif
+
+bool WriteLexerCache(const ProgramInternalForm* pif, uint64_t input_hash, const char* path)
+{
+	if (pif->identifier_fa.verify_mode != FA_VERIFY_DENSE || pif->identifier_fa.compiled.transitions == NULL
+		|| pif->integer_constant_fa.verify_mode != FA_VERIFY_DENSE || pif->integer_constant_fa.compiled.transitions == NULL
+		|| pif->classifier.automata.transitions == NULL) {
+		return false;
+	}
+
+	// Many processes can write the same cache at once, each of them writes its own temporary file.
+	// The process id and a counter of the process make the name unique
+	static unsigned long write_count = 0;
+	size_t temporary_path_size = strlen(path) + 64;
+	char* temporary_path = _alloca(temporary_path_size);
+	snprintf(temporary_path, temporary_path_size, "%s.%lu.%lu.tmp", path, GetCacheWriterId(), write_count++);
+
+	CacheWriter writer;
+	writer.file = fopen(temporary_path, "wb");
+	if (writer.file == NULL) {
+		return false;
+	}
+	writer.checksum = LEXER_CACHE_HASH_OFFSET;
+	writer.size = 0;
+	writer.failed = false;
+
+	// The header is written again at the end, when the checksum is known
+	LexerCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	fwrite(&header, sizeof(header), 1, writer.file);
+
+	WriteCacheStrings(&writer, pif->operators);
+	WriteCacheStrings(&writer, pif->separators);
+	WriteCacheStrings(&writer, pif->reserved_words);
+
+	WriteCacheAutomata(&writer, &pif->classifier.automata);
+	WriteCacheCount(&writer, pif->classifier.labels.size);
+	WriteCacheBytes(&writer, pif->classifier.labels.buffer, sizeof(Token) * pif->classifier.labels.size);
+
+	WriteCacheAutomata(&writer, &pif->identifier_fa.compiled);
+	WriteCacheAutomata(&writer, &pif->integer_constant_fa.compiled);
+
+	header.magic = LEXER_CACHE_MAGIC;
+	header.version = LEXER_CACHE_VERSION;
+	header.layout = LEXER_CACHE_LAYOUT;
+	header.input_hash = input_hash;
+	header.payload_checksum = writer.checksum;
+	header.payload_size = writer.size;
+	if (fseek(writer.file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, writer.file) != 1) {
+		writer.failed = true;
+	}
+	if (fclose(writer.file) != 0) {
+		writer.failed = true;
+	}
+
+	if (writer.failed) {
+		remove(temporary_path);
+		return false;
+	}
+	// The cache is never removed first, else another process could find no cache in between
+	if (!ReplaceCacheFile(temporary_path, path)) {
+		remove(temporary_path);
+		return false;
+	}
+	return true;
+}
+
+typedef struct {
+	const char* position;
+	const char* end;
+} CacheReader;
+
+// Returns NULL if the file is too short
+static const void* ReadCacheBytes(CacheReader* reader, size_t size) {
+	size_t aligned_size = AlignCacheSize(size);
+	if (aligned_size < size || (size_t)(reader->end - reader->position) < aligned_size) {
+		return NULL;
+	}
+	const void* bytes = reader->position;
+	reader->position += aligned_size;
+	return bytes;
+}
+
+static bool ReadCacheCount(CacheReader* reader, uint64_t* count) {
+	const uint64_t* value = ReadCacheBytes(reader, sizeof(uint64_t));
+	if (value == NULL) {
+		return false;
+	}
+	*count = *value;
+	return true;
+}
+
+// The string descriptors are allocated, the characters stay in the mapping
+static bool ReadCacheStrings(CacheReader* reader, ResizableStream* strings) {
+	uint64_t count;
+	if (!ReadCacheCount(reader, &count) || count > (uint64_t)(reader->end - reader->position)) {
+		return false;
+	}
+
+	*strings = CreateStream(count, sizeof(string));
+	for (uint64_t index = 0; index < count; index++) {
+		uint64_t size;
+		const char* characters = NULL;
+		if (ReadCacheCount(reader, &size) && size < (uint64_t)(reader->end - reader->position)) {
+			characters = ReadCacheBytes(reader, size + 1);
+		}
+		if (characters == NULL) {
+			FreeStream(*strings);
+			return false;
+		}
+		string _string = { (char*)characters, size };
+		Add(strings, &_string);
+	}
+	return true;
+}
+
+static bool ReadCacheAutomata(CacheReader* reader, DenseAutomata* dense_automata) {
+	uint64_t state_count, initial_state, class_count;
+	if (!ReadCacheCount(reader, &state_count) || !ReadCacheCount(reader, &initial_state) || !ReadCacheCount(reader, &class_count)) {
+		return false;
+	}
+	// Rejects the counts that would overflow the sizes below
+	if (state_count == 0 || initial_state >= state_count || state_count > (uint64_t)(reader->end - reader->position)
+		|| class_count == 0 || class_count > DENSE_AUTOMATA_ALPHABET_SIZE) {
+		return false;
+	}
+
+	// The classes are copied, they are a part of the automata structure
+	const unsigned char* byte_classes = ReadCacheBytes(reader, sizeof(dense_automata->byte_classes));
+	if (byte_classes == NULL) {
+		return false;
+	}
+	for (size_t terminal = 0; terminal < DENSE_AUTOMATA_ALPHABET_SIZE; terminal++) {
+		if (byte_classes[terminal] >= class_count) {
+			return false;
+		}
+	}
+	memcpy(dense_automata->byte_classes, byte_classes, sizeof(dense_automata->byte_classes));
+
+	dense_automata->state_count = state_count;
+	dense_automata->initial_state = (unsigned int)initial_state;
+	dense_automata->class_count = class_count;
+	dense_automata->transitions = (unsigned int*)ReadCacheBytes(reader, sizeof(unsigned int) * class_count * state_count);
+	dense_automata->accept_labels = (size_t*)ReadCacheBytes(reader, sizeof(size_t) * state_count);
+	dense_automata->accepting_states = (uint64_t*)ReadCacheBytes(reader, sizeof(uint64_t) * (state_count / 64 + 1));
+	return dense_automata->transitions != NULL && dense_automata->accept_labels != NULL && dense_automata->accepting_states != NULL;
+}
+
+bool LoadLexerCache(ProgramInternalForm* pif, uint64_t input_hash, const char* path)
+{
+	MappedFile cache;
+	if (!MapFile(path, &cache)) {
+		return false;
+	}
+
+	ResizableStream operators = { 0 };
+	ResizableStream separators = { 0 };
+	ResizableStream reserved_words = { 0 };
+
+#define DEALLOCATE FreeStream(operators); FreeStream(separators); FreeStream(reserved_words); UnmapFile(&cache);
+
+	if (cache.contents.size < sizeof(LexerCacheHeader)) {
+		DEALLOCATE;
+		return false;
+	}
+
+	const LexerCacheHeader* header = (const LexerCacheHeader*)cache.contents.characters;
+	const char* payload = cache.contents.characters + sizeof(LexerCacheHeader);
+	size_t payload_size = cache.contents.size - sizeof(LexerCacheHeader);
+	if (header->magic != LEXER_CACHE_MAGIC || header->version != LEXER_CACHE_VERSION || header->layout != LEXER_CACHE_LAYOUT
+		|| header->input_hash != input_hash || header->payload_size != payload_size || payload_size % LEXER_CACHE_ALIGNMENT != 0
+		|| HashCacheWords(LEXER_CACHE_HASH_OFFSET, payload, payload_size) != header->payload_checksum) {
+		DEALLOCATE;
+		return false;
+	}
+
+	CacheReader reader = { payload, payload + payload_size };
+	DenseAutomata classifier_automata, identifier_automata, integer_constant_automata;
+	uint64_t label_count;
+	const Token* labels = NULL;
+
+	bool success = ReadCacheStrings(&reader, &operators);
+	success = success && ReadCacheStrings(&reader, &separators);
+	success = success && ReadCacheStrings(&reader, &reserved_words);
+	success = success && ReadCacheAutomata(&reader, &classifier_automata);
+	success = success && ReadCacheCount(&reader, &label_count) && label_count <= payload_size / sizeof(Token);
+	success = success && (labels = ReadCacheBytes(&reader, sizeof(Token) * label_count)) != NULL;
+	success = success && ReadCacheAutomata(&reader, &identifier_automata);
+	success = success && ReadCacheAutomata(&reader, &integer_constant_automata);
+	if (!success) {
+		DEALLOCATE;
+		return false;
+	}
+
+#undef DEALLOCATE
+
+	FreeStream(pif->operators);
+	FreeStream(pif->separators);
+	FreeStream(pif->reserved_words);
+	pif->operators = operators;
+	pif->separators = separators;
+	pif->reserved_words = reserved_words;
+
+	pif->classifier.automata = classifier_automata;
+	pif->classifier.labels.buffer = (void*)labels;
+	pif->classifier.labels.size = label_count;
+	pif->classifier.labels.capacity = label_count;
+	pif->classifier.labels.element_size = sizeof(Token);
+
+	pif->identifier_fa.compiled = identifier_automata;
+	pif->identifier_fa.verify_mode = FA_VERIFY_DENSE;
+	pif->integer_constant_fa.compiled = integer_constant_automata;
+	pif->integer_constant_fa.verify_mode = FA_VERIFY_DENSE;
+
+	pif->cache = cache;
+	return true;
+}
+
+void ReleaseLexerCache(ProgramInternalForm* pif)
+{
+	if (pif->cache.contents.size == 0) {
+		return;
+	}
+
+	// Only the string descriptors were allocated, the characters belong to the mapping
+	for (size_t index = 0; index < pif->operators.size; index++) {
+		memset(GetElement(pif->operators, index), 0, sizeof(string));
+	}
+	for (size_t index = 0; index < pif->separators.size; index++) {
+		memset(GetElement(pif->separators, index), 0, sizeof(string));
+	}
+	for (size_t index = 0; index < pif->reserved_words.size; index++) {
+		memset(GetElement(pif->reserved_words, index), 0, sizeof(string));
+	}
+
+	memset(&pif->classifier.automata, 0, sizeof(pif->classifier.automata));
+	memset(&pif->classifier.labels, 0, sizeof(pif->classifier.labels));
+	memset(&pif->identifier_fa.compiled, 0, sizeof(pif->identifier_fa.compiled));
+	memset(&pif->integer_constant_fa.compiled, 0, sizeof(pif->integer_constant_fa.compiled));
+
+	UnmapFile(&pif->cache);
+}
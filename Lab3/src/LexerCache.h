@@ -0,0 +1,58 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "ProgramInternalForm.h"
+
+/*
+	The first bytes of every cache file
+*/
+#define LEXER_CACHE_MAGIC 0x4843584Cu
+
+/*
+	Must be incremented every time the layout of the cache file or of the tables inside it changes
+*/
+#define LEXER_CACHE_VERSION 3
+
+/*
+	The cache is only valid on machines with the same integer sizes and byte order as the one that wrote it
+*/
+#define LEXER_CACHE_LAYOUT ((uint32_t)sizeof(size_t) | ((uint32_t)sizeof(Token) << 8) | ((uint32_t)sizeof(unsigned int) << 16))
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t layout;
+	uint32_t padding;
+	// The hash of the token file and of the automata files the lexer was built from
+	uint64_t input_hash;
+	// A hash over the 64 bit words of the payload, which follows the header
+	uint64_t payload_checksum;
+	uint64_t payload_size;
+} LexerCacheHeader;
+
+/*
+	Hashes the contents of the files. Returns false if any of them could not be opened
+*/
+bool HashLexerInputs(const char* const* paths, size_t path_count, uint64_t* input_hash);
+
+/*
+	Serializes the token lists, the classifier and the compiled automatas of a pif that was filled by ReadTokenFile.
+	The file is written under a temporary name of its own and then renamed over the cache in one step, such that
+	a reader never sees a partial file and concurrent writers do not mix their files. The last writer wins.
+	Returns false if the automatas are not dense or the file could not be written
+*/
+bool WriteLexerCache(const ProgramInternalForm* pif, uint64_t input_hash, const char* path);
+
+/*
+	Maps the cache file and points the token lists, the classifier and the compiled automatas of the pif into it.
+	Nothing is parsed, the header is compared and the payload is checksummed. The lookup tables that hold pointers
+	(the delimiter trie and the keyword hash) are not part of the cache. The pif must be freshly created.
+	Returns false, without modifying the pif, if the file is missing, stale or corrupted
+*/
+bool LoadLexerCache(ProgramInternalForm* pif, uint64_t input_hash, const char* path);
+
+/*
+	Detaches the tables that point into the cache mapping and unmaps it. Does nothing if the pif was not loaded
+	from a cache. DestroyPIF calls it before releasing the rest of the pif
+*/
+void ReleaseLexerCache(ProgramInternalForm* pif);
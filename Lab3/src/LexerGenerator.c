@@ -0,0 +1,321 @@
+#include "LexerGenerator.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GENERATED_VALUES_PER_LINE 16
+
+static const char* TOKEN_CLASS_NAMES[] = {
+	"TOKEN_IDENTIFIER",
+	"TOKEN_INT_CONSTANT",
+	"TOKEN_FLOAT_CONSTANT",
+	"TOKEN_BOOL_CONSTANT",
+	"TOKEN_STRING_CONSTANT",
+	"TOKEN_RESERVED",
+	"TOKEN_OPERATOR",
+	"TOKEN_SEPARATOR"
+};
+
+static const char* DELIMITER_KIND_NAMES[] = {
+	"DELIMITER_NONE",
+	"DELIMITER_OPERATOR",
+	"DELIMITER_SEPARATOR"
+};
+
+static void WriteGeneratedLineBreak(FILE* file, size_t index) {
+	if (index % GENERATED_VALUES_PER_LINE == 0) {
+		fprintf(file, "\n\t");
+	}
+}
+
+static void WriteGeneratedString(FILE* file, string _string) {
+	fputc('"', file);
+	for (size_t index = 0; index < _string.size; index++) {
+		unsigned char character = _string.characters[index];
+		if (character == '"' || character == '\\') {
+			fprintf(file, "\\%c", character);
+		}
+		else if (character >= ' ' && character < 127) {
+			fputc(character, file);
+		}
+		else {
+			fprintf(file, "\\%03o", character);
+		}
+	}
+	fputc('"', file);
+}
+
+static void WriteGeneratedStringInitializer(FILE* file, string _string) {
+	if (_string.characters == NULL) {
+		fprintf(file, "{ NULL, (size_t)-1 }");
+	}
+	else {
+		fprintf(file, "{ (char*)");
+		WriteGeneratedString(file, _string);
+		fprintf(file, ", %zu }", _string.size);
+	}
+}
+
+// The indices that are -1 are written as such instead of the platform dependent maximum
+static void WriteGeneratedIndex(FILE* file, size_t index) {
+	if (index == (size_t)-1) {
+		fprintf(file, "(size_t)-1");
+	}
+	else {
+		fprintf(file, "%zu", index);
+	}
+}
+
+static void WriteGeneratedTokenInitializer(FILE* file, const Token* token) {
+	fprintf(file, "{ %s, ", TOKEN_CLASS_NAMES[token->token_class]);
+	WriteGeneratedIndex(file, token->entry_index);
+	fprintf(file, " }");
+}
+
+// C does not allow empty initializer lists, the empty arrays receive a single unused element
+static void WriteGeneratedStrings(FILE* file, const char* name, ResizableStream strings) {
+	fprintf(file, "static const string %s[] = {\n", name);
+	for (size_t index = 0; index < strings.size; index++) {
+		fprintf(file, "\t");
+		WriteGeneratedStringInitializer(file, *(const string*)GetElement(strings, index));
+		fprintf(file, ",\n");
+	}
+	if (strings.size == 0) {
+		fprintf(file, "\t{ NULL, 0 }\n");
+	}
+	fprintf(file, "};\n\n");
+}
+
+static void WriteGeneratedAutomata(FILE* file, const char* name, const DenseAutomata* dense_automata) {
+	fprintf(file, "#define %s_CLASS_COUNT %zu\n\n", name, dense_automata->class_count);
+	fprintf(file, "static const unsigned char %s_byte_classes[] = {", name);
+	for (size_t index = 0; index < DENSE_AUTOMATA_ALPHABET_SIZE; index++) {
+		WriteGeneratedLineBreak(file, index);
+		fprintf(file, "%u, ", dense_automata->byte_classes[index]);
+	}
+	fprintf(file, "\n};\n\n");
+
+	size_t transition_count = dense_automata->state_count * dense_automata->class_count;
+	fprintf(file, "static const unsigned int %s_transitions[] = {", name);
+	for (size_t index = 0; index < transition_count; index++) {
+		WriteGeneratedLineBreak(file, index);
+		fprintf(file, "%u, ", dense_automata->transitions[index]);
+	}
+	fprintf(file, "\n};\n\n");
+
+	fprintf(file, "static const size_t %s_accept_labels[] = {", name);
+	for (size_t index = 0; index < dense_automata->state_count; index++) {
+		WriteGeneratedLineBreak(file, index);
+		if (dense_automata->accept_labels[index] == DENSE_AUTOMATA_NO_LABEL) {
+			fprintf(file, "DENSE_AUTOMATA_NO_LABEL, ");
+		}
+		else {
+			fprintf(file, "%zu, ", dense_automata->accept_labels[index]);
+		}
+	}
+	fprintf(file, "\n};\n\n");
+
+	size_t accepting_word_count = dense_automata->state_count / 64 + 1;
+	fprintf(file, "static const uint64_t %s_accepting_states[] = {", name);
+	for (size_t index = 0; index < accepting_word_count; index++) {
+		WriteGeneratedLineBreak(file, index);
+		fprintf(file, "0x%016llxull, ", (unsigned long long)dense_automata->accepting_states[index]);
+	}
+	fprintf(file, "\n};\n\n");
+}
+
+static void WriteGeneratedAutomataLoad(FILE* file, const char* target, const char* name, const DenseAutomata* dense_automata) {
+	fprintf(file, "\t%s.transitions = (unsigned int*)%s_transitions;\n", target, name);
+	fprintf(file, "\t%s.accept_labels = (size_t*)%s_accept_labels;\n", target, name);
+	fprintf(file, "\t%s.accepting_states = (uint64_t*)%s_accepting_states;\n", target, name);
+	fprintf(file, "\t%s.state_count = %zu;\n", target, dense_automata->state_count);
+	fprintf(file, "\t%s.initial_state = %u;\n", target, dense_automata->initial_state);
+	fprintf(file, "\t%s.class_count = %s_CLASS_COUNT;\n", target, name);
+	fprintf(file, "\tmemcpy(%s.byte_classes, %s_byte_classes, sizeof(%s_byte_classes));\n", target, name, name);
+}
+
+static void WriteGeneratedDelimiters(FILE* file, const DelimiterTrie* trie) {
+	fprintf(file, "static const DelimiterTrieEdge generated_delimiter_edges[] = {\n");
+	size_t edge_count = 0;
+	for (size_t index = 0; index < trie->nodes.size; index++) {
+		const DelimiterTrieNode* node = GetElement(trie->nodes, index);
+		for (size_t subindex = 0; subindex < node->children.size; subindex++) {
+			const DelimiterTrieEdge* edge = GetElement(node->children, subindex);
+			fprintf(file, "\t{ %u, %zu },\n", edge->character, edge->node);
+			edge_count++;
+		}
+	}
+	if (edge_count == 0) {
+		fprintf(file, "\t{ 0, 0 }\n");
+	}
+	fprintf(file, "};\n\n");
+
+	fprintf(file, "static const DelimiterTrieNode generated_delimiter_nodes[] = {\n");
+	size_t edge_offset = 0;
+	for (size_t index = 0; index < trie->nodes.size; index++) {
+		const DelimiterTrieNode* node = GetElement(trie->nodes, index);
+		fprintf(
+			file,
+			"\t{ GENERATED_STREAM(generated_delimiter_edges + %zu, %zu, sizeof(DelimiterTrieEdge)), %s, ",
+			edge_offset,
+			node->children.size,
+			DELIMITER_KIND_NAMES[node->kind]
+		);
+		WriteGeneratedIndex(file, node->delimiter_index);
+		fprintf(file, " },\n");
+		edge_offset += node->children.size;
+	}
+	fprintf(file, "};\n\n");
+
+	fprintf(file, "static const DelimiterTrie generated_delimiters = {\n");
+	fprintf(file, "\tGENERATED_STREAM(generated_delimiter_nodes, %zu, sizeof(DelimiterTrieNode)),\n\t{", trie->nodes.size);
+	for (size_t index = 0; index < 256; index++) {
+		if (index % GENERATED_VALUES_PER_LINE == 0) {
+			fprintf(file, "\n\t\t");
+		}
+		fprintf(file, "%zu, ", trie->root_children[index]);
+	}
+	fprintf(file, "\n\t}\n};\n\n");
+}
+
+static void WriteGeneratedFindKeyword(FILE* file) {
+	fprintf(file, "// The reserved words that the classifier automata leaves to the keyword hash\n");
+	fprintf(file, "static bool GeneratedFindKeyword(string token, Token* result) {\n");
+	fprintf(file, "\tconst Token* keyword = FindPerfectHash(&generated_keywords, token);\n");
+	fprintf(file, "\tif (keyword == NULL) {\n\t\treturn false;\n\t}\n");
+	fprintf(file, "\t*result = *keyword;\n\treturn true;\n}\n\n");
+}
+
+static void WriteGeneratedKeywords(FILE* file, const PerfectHash* keywords) {
+	if (keywords->uses_fallback) {
+		// The fallback hash table cannot be written as static tables, LoadGeneratedLexer builds it
+		fprintf(file, "static PerfectHash generated_keywords;\n\n");
+		WriteGeneratedFindKeyword(file);
+		return;
+	}
+
+	size_t slot_count = keywords->slot_mask + 1;
+	fprintf(file, "static const string generated_keyword_slot_keys[] = {\n");
+	for (size_t index = 0; index < slot_count; index++) {
+		fprintf(file, "\t");
+		WriteGeneratedStringInitializer(file, keywords->slot_keys[index]);
+		fprintf(file, ",\n");
+	}
+	fprintf(file, "};\n\n");
+
+	// The values of the free slots are never read
+	fprintf(file, "static const Token generated_keyword_slot_values[] = {\n");
+	for (size_t index = 0; index < slot_count; index++) {
+		const Token* token = (const Token*)keywords->slot_values + index;
+		Token empty_token = { TOKEN_IDENTIFIER, 0 };
+		fprintf(file, "\t");
+		WriteGeneratedTokenInitializer(file, keywords->slot_keys[index].characters != NULL ? token : &empty_token);
+		fprintf(file, ",\n");
+	}
+	fprintf(file, "};\n\n");
+
+	fprintf(file, "static const unsigned int generated_keyword_displacements[] = {");
+	for (size_t index = 0; index <= keywords->bucket_mask; index++) {
+		WriteGeneratedLineBreak(file, index);
+		fprintf(file, "%u, ", keywords->displacements[index]);
+	}
+	fprintf(file, "\n};\n\n");
+
+	fprintf(file, "static const PerfectHash generated_keywords = {\n");
+	fprintf(file, "\t(string*)generated_keyword_slot_keys,\n\t(void*)generated_keyword_slot_values,\n\t(unsigned int*)generated_keyword_displacements,\n");
+	fprintf(file, "\t%zu,\n\t%zu,\n\tsizeof(Token),\n\tfalse\n};\n\n", keywords->slot_mask, keywords->bucket_mask);
+
+	WriteGeneratedFindKeyword(file);
+}
+
+static void WriteGeneratedClassifyFunction(FILE* file, const TokenClassifier* classifier) {
+	const DenseAutomata* automata = &classifier->automata;
+	fprintf(file, "bool GeneratedClassifyToken(string token, Token* result)\n{\n");
+	fprintf(file, "\tunsigned int state = %u;\n", automata->initial_state);
+	fprintf(file, "\tfor (size_t index = 0; index < token.size; index++) {\n");
+	fprintf(file, "\t\tstate = generated_classifier_transitions[(size_t)state * generated_classifier_CLASS_COUNT + generated_classifier_byte_classes[(unsigned char)token.characters[index]]];\n");
+	fprintf(file, "\t\tif (state == DENSE_AUTOMATA_DEAD_STATE) {\n\t\t\treturn false;\n\t\t}\n\t}\n\n");
+
+	fprintf(file, "\tswitch (state) {\n");
+	for (size_t state = 0; state < automata->state_count; state++) {
+		size_t label = automata->accept_labels[state];
+		if (label == DENSE_AUTOMATA_NO_LABEL) {
+			continue;
+		}
+		const Token* token = GetElement(classifier->labels, label);
+		fprintf(file, "\tcase %zu:\n", state);
+		if (token->token_class < TOKEN_RESERVED) {
+			fprintf(file, "\t\tif (GeneratedFindKeyword(token, result)) {\n\t\t\treturn true;\n\t\t}\n");
+		}
+		fprintf(file, "\t\tresult->token_class = %s;\n", TOKEN_CLASS_NAMES[token->token_class]);
+		fprintf(file, "\t\tresult->entry_index = ");
+		WriteGeneratedIndex(file, token->entry_index);
+		fprintf(file, ";\n");
+		fprintf(file, "\t\treturn true;\n");
+	}
+	fprintf(file, "\t}\n\treturn false;\n}\n\n");
+}
+
+bool GenerateLexerSource(const ProgramInternalForm* pif, const char* path)
+{
+	if (pif->classifier.automata.transitions == NULL
+		|| pif->identifier_fa.verify_mode != FA_VERIFY_DENSE || pif->identifier_fa.compiled.transitions == NULL
+		|| pif->integer_constant_fa.verify_mode != FA_VERIFY_DENSE || pif->integer_constant_fa.compiled.transitions == NULL) {
+		return false;
+	}
+
+	FILE* file = fopen(path, "wt");
+	if (file == NULL) {
+		return false;
+	}
+
+	fprintf(file, "// Generated by GenerateLexerSource from the token and automata files, do not edit.\n");
+	fprintf(file, "// It is compiled only into the builds that define LEXER_STATIC_TABLES\n");
+	fprintf(file, "#include \"GeneratedLexer.h\"\n");
+	fprintf(file, "#include <string.h>\n\n");
+	fprintf(file, "#define GENERATED_STREAM(buffer, size, element_size) { (void*)(buffer), size, size, element_size }\n\n");
+
+	WriteGeneratedStrings(file, "generated_operators", pif->operators);
+	WriteGeneratedStrings(file, "generated_separators", pif->separators);
+	WriteGeneratedStrings(file, "generated_reserved_words", pif->reserved_words);
+	WriteGeneratedDelimiters(file, &pif->delimiters);
+	WriteGeneratedKeywords(file, &pif->classifier.keywords);
+
+	WriteGeneratedAutomata(file, "generated_classifier", &pif->classifier.automata);
+	fprintf(file, "static const Token generated_classifier_labels[] = {\n");
+	for (size_t index = 0; index < pif->classifier.labels.size; index++) {
+		fprintf(file, "\t");
+		WriteGeneratedTokenInitializer(file, GetElement(pif->classifier.labels, index));
+		fprintf(file, ",\n");
+	}
+	fprintf(file, "};\n\n");
+
+	WriteGeneratedAutomata(file, "generated_identifier", &pif->identifier_fa.compiled);
+	WriteGeneratedAutomata(file, "generated_integer_constant", &pif->integer_constant_fa.compiled);
+
+	fprintf(file, "void LoadGeneratedLexer(ProgramInternalForm* pif)\n{\n");
+	fprintf(file, "\tpif->operators = (ResizableStream)GENERATED_STREAM(generated_operators, %zu, sizeof(string));\n", pif->operators.size);
+	fprintf(file, "\tpif->separators = (ResizableStream)GENERATED_STREAM(generated_separators, %zu, sizeof(string));\n", pif->separators.size);
+	fprintf(file, "\tpif->reserved_words = (ResizableStream)GENERATED_STREAM(generated_reserved_words, %zu, sizeof(string));\n", pif->reserved_words.size);
+	fprintf(file, "\tpif->delimiters = generated_delimiters;\n\n");
+
+	WriteGeneratedAutomataLoad(file, "pif->classifier.automata", "generated_classifier", &pif->classifier.automata);
+	fprintf(file, "\tpif->classifier.labels = (ResizableStream)GENERATED_STREAM(generated_classifier_labels, %zu, sizeof(Token));\n", pif->classifier.labels.size);
+	if (pif->classifier.keywords.uses_fallback) {
+		fprintf(file, "\tCreateTokenClassifierKeywords(&pif->classifier, pif->reserved_words);\n");
+		fprintf(file, "\tgenerated_keywords = pif->classifier.keywords;\n\n");
+	}
+	else {
+		fprintf(file, "\tpif->classifier.keywords = generated_keywords;\n\n");
+	}
+	WriteGeneratedAutomataLoad(file, "pif->identifier_fa.compiled", "generated_identifier", &pif->identifier_fa.compiled);
+	fprintf(file, "\tpif->identifier_fa.verify_mode = FA_VERIFY_DENSE;\n\n");
+	WriteGeneratedAutomataLoad(file, "pif->integer_constant_fa.compiled", "generated_integer_constant", &pif->integer_constant_fa.compiled);
+	fprintf(file, "\tpif->integer_constant_fa.verify_mode = FA_VERIFY_DENSE;\n\n");
+	fprintf(file, "\tpif->has_static_tables = true;\n}\n\n");
+
+	WriteGeneratedClassifyFunction(file, &pif->classifier);
+
+	bool success = !ferror(file);
+	success = fclose(file) == 0 && success;
+	return success;
+}
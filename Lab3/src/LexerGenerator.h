@@ -0,0 +1,12 @@
+#pragma once
+#include <stdbool.h>
+#include "ProgramInternalForm.h"
+
+/*
+	Writes a C source file with the lexer of the pif as static const tables: the token lists, the delimiter trie,
+	the keyword perfect hash, the classifier and the compiled automatas, together with the functions declared in
+	GeneratedLexer.h. The classification of the accepting states is emitted as a switch. The pif must be filled
+	by ReadTokenFile or ReadTokenFileCached. A keyword hash that fell back to a regular hash table is built again
+	by LoadGeneratedLexer. Returns false if an automata is not dense or the file cannot be written
+*/
+bool GenerateLexerSource(const ProgramInternalForm* pif, const char* path);
@@ -0,0 +1,252 @@
+#include "PerfectHash.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t PerfectHashMix(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+static uint64_t PerfectHashString(string key) {
+	// FNV-1a over the bytes
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t index = 0; index < key.size; index++) {
+		hash ^= (unsigned char)key.characters[index];
+		hash *= 1099511628211ull;
+	}
+	return PerfectHashMix(hash);
+}
+
+static size_t PerfectHashSlot(uint64_t hash, unsigned int displacement, size_t slot_mask) {
+	return (size_t)PerfectHashMix(hash ^ ((uint64_t)displacement * 0x9E3779B97F4A7C15ull)) & slot_mask;
+}
+
+static size_t PerfectHashBucket(uint64_t hash, size_t bucket_mask) {
+	// The high bits are used for the bucket, the slot mixes all of them again
+	return (size_t)(hash >> 32) & bucket_mask;
+}
+
+static size_t NextPowerOfTwo(size_t value) {
+	size_t power = 1;
+	while (power < value) {
+		power <<= 1;
+	}
+	return power;
+}
+
+static int PerfectHashFallbackCompare(const void* first, const void* second) {
+	return StringEqual(*(const string*)first, *(const string*)second);
+}
+
+static size_t PerfectHashFallbackHash(const void* identifier) {
+	return (size_t)PerfectHashString(*(const string*)identifier);
+}
+
+typedef struct {
+	uint64_t hash;
+	size_t key_index;
+} PerfectHashKey;
+
+static int ComparePerfectHashKeys(const void* first, const void* second) {
+	const PerfectHashKey* first_key = first;
+	const PerfectHashKey* second_key = second;
+	if (first_key->hash != second_key->hash) {
+		return first_key->hash < second_key->hash ? -1 : 1;
+	}
+	// Equal hashes are ordered by the index such that the first duplicate is the one kept
+	return first_key->key_index < second_key->key_index ? -1 : (first_key->key_index > second_key->key_index ? 1 : 0);
+}
+
+/*
+	Searches the displacements for the given slot count. The keys must be unique. Returns false if a bucket
+	could not be placed
+*/
+static bool PlacePerfectHashKeys(PerfectHash* perfect_hash, const PerfectHashKey* hashed_keys, size_t count, size_t slot_count, bool* occupied) {
+	size_t bucket_count = perfect_hash->bucket_mask + 1;
+	memset(occupied, 0, sizeof(bool) * slot_count);
+
+	// Counting sort of the keys by bucket. The bucket starts are followed by the key indices
+	size_t* bucket_starts = calloc(bucket_count + 1, sizeof(size_t));
+	size_t* bucket_keys = malloc(sizeof(size_t) * count);
+	for (size_t index = 0; index < count; index++) {
+		bucket_starts[PerfectHashBucket(hashed_keys[index].hash, perfect_hash->bucket_mask) + 1]++;
+	}
+	size_t max_bucket_size = 0;
+	for (size_t index = 0; index < bucket_count; index++) {
+		max_bucket_size = max(max_bucket_size, bucket_starts[index + 1]);
+		bucket_starts[index + 1] += bucket_starts[index];
+	}
+	size_t* bucket_fill = malloc(sizeof(size_t) * bucket_count);
+	memcpy(bucket_fill, bucket_starts, sizeof(size_t) * bucket_count);
+	for (size_t index = 0; index < count; index++) {
+		size_t bucket = PerfectHashBucket(hashed_keys[index].hash, perfect_hash->bucket_mask);
+		bucket_keys[bucket_fill[bucket]++] = index;
+	}
+
+	size_t* bucket_slots = malloc(sizeof(size_t) * (max_bucket_size + 1));
+	bool success = true;
+	// The biggest buckets are placed first, while there are still many free slots
+	for (size_t bucket_size = max_bucket_size; bucket_size > 0 && success; bucket_size--) {
+		for (size_t bucket = 0; bucket < bucket_count; bucket++) {
+			size_t bucket_start = bucket_starts[bucket];
+			if (bucket_starts[bucket + 1] - bucket_start != bucket_size) {
+				continue;
+			}
+
+			unsigned int displacement = 0;
+			for (; displacement < PERFECT_HASH_MAX_DISPLACEMENT_ATTEMPTS; displacement++) {
+				size_t placed = 0;
+				for (; placed < bucket_size; placed++) {
+					size_t slot = PerfectHashSlot(hashed_keys[bucket_keys[bucket_start + placed]].hash, displacement, perfect_hash->slot_mask);
+					if (occupied[slot]) {
+						break;
+					}
+					// Keys of the same bucket must not collide between themselves either
+					occupied[slot] = true;
+					bucket_slots[placed] = slot;
+				}
+
+				if (placed == bucket_size) {
+					break;
+				}
+				for (size_t index = 0; index < placed; index++) {
+					occupied[bucket_slots[index]] = false;
+				}
+			}
+
+			if (displacement == PERFECT_HASH_MAX_DISPLACEMENT_ATTEMPTS) {
+				success = false;
+				break;
+			}
+			perfect_hash->displacements[bucket] = displacement;
+		}
+	}
+
+	free(bucket_slots);
+	free(bucket_fill);
+	free(bucket_keys);
+	free(bucket_starts);
+	return success;
+}
+
+PerfectHash CreatePerfectHash(const string* keys, const void* values, size_t count, size_t value_size)
+{
+	PerfectHash perfect_hash;
+	memset(&perfect_hash, 0, sizeof(perfect_hash));
+	perfect_hash.value_size = value_size;
+
+	// Hash every key once and drop the duplicates
+	PerfectHashKey* hashed_keys = malloc(sizeof(PerfectHashKey) * (count + 1));
+	for (size_t index = 0; index < count; index++) {
+		hashed_keys[index].hash = PerfectHashString(keys[index]);
+		hashed_keys[index].key_index = index;
+	}
+	qsort(hashed_keys, count, sizeof(PerfectHashKey), ComparePerfectHashKeys);
+	size_t unique_count = 0;
+	for (size_t index = 0; index < count; index++) {
+		bool is_duplicate = false;
+		for (size_t previous = unique_count; previous > 0 && hashed_keys[previous - 1].hash == hashed_keys[index].hash; previous--) {
+			if (StringEqual(keys[hashed_keys[previous - 1].key_index], keys[hashed_keys[index].key_index])) {
+				is_duplicate = true;
+				break;
+			}
+		}
+		if (!is_duplicate) {
+			hashed_keys[unique_count++] = hashed_keys[index];
+		}
+	}
+
+	bool placed = false;
+	if (unique_count <= PERFECT_HASH_MAX_KEYS) {
+		size_t slot_count = NextPowerOfTwo(max(unique_count * 100 / PERFECT_HASH_LOAD_FACTOR + 1, 8));
+		size_t bucket_count = NextPowerOfTwo(unique_count / PERFECT_HASH_BUCKET_SIZE + 1);
+		perfect_hash.bucket_mask = bucket_count - 1;
+		perfect_hash.displacements = malloc(sizeof(unsigned int) * bucket_count);
+
+		// Two attempts with a bigger table before giving up
+		for (size_t attempt = 0; attempt < 3 && !placed; attempt++) {
+			bool* occupied = malloc(sizeof(bool) * slot_count);
+			perfect_hash.slot_mask = slot_count - 1;
+			placed = PlacePerfectHashKeys(&perfect_hash, hashed_keys, unique_count, slot_count, occupied);
+			free(occupied);
+			if (!placed) {
+				slot_count <<= 1;
+			}
+		}
+
+		if (placed) {
+			// The keys and the values share a single allocation
+			perfect_hash.slot_keys = malloc((sizeof(string) + value_size) * slot_count);
+			perfect_hash.slot_values = perfect_hash.slot_keys + slot_count;
+			for (size_t index = 0; index < slot_count; index++) {
+				perfect_hash.slot_keys[index] = (string){ NULL, (size_t)-1 };
+			}
+
+			for (size_t index = 0; index < unique_count; index++) {
+				uint64_t hash = hashed_keys[index].hash;
+				size_t key_index = hashed_keys[index].key_index;
+				size_t slot = PerfectHashSlot(hash, perfect_hash.displacements[PerfectHashBucket(hash, perfect_hash.bucket_mask)], perfect_hash.slot_mask);
+				perfect_hash.slot_keys[slot] = keys[key_index];
+				memcpy((char*)perfect_hash.slot_values + slot * value_size, (const char*)values + key_index * value_size, value_size);
+			}
+		}
+		else {
+			free(perfect_hash.displacements);
+			perfect_hash.displacements = NULL;
+		}
+	}
+
+	if (!placed) {
+		perfect_hash.uses_fallback = true;
+		perfect_hash.fallback = CreateTable(
+			NextPowerOfTwo(max(unique_count * 2, 16)),
+			value_size,
+			sizeof(string),
+			HashTableMapPowerOfTwo,
+			PerfectHashFallbackHash,
+			PerfectHashFallbackCompare
+		);
+		for (size_t index = 0; index < unique_count; index++) {
+			size_t key_index = hashed_keys[index].key_index;
+			AddTable(&perfect_hash.fallback, (const char*)values + key_index * value_size, &keys[key_index]);
+		}
+	}
+
+	free(hashed_keys);
+	return perfect_hash;
+}
+
+const void* FindPerfectHash(const PerfectHash* perfect_hash, string key)
+{
+	if (perfect_hash->uses_fallback) {
+		return FindTablePtr(&perfect_hash->fallback, &key);
+	}
+	if (perfect_hash->slot_keys == NULL) {
+		return NULL;
+	}
+
+	uint64_t hash = PerfectHashString(key);
+	size_t slot = PerfectHashSlot(hash, perfect_hash->displacements[PerfectHashBucket(hash, perfect_hash->bucket_mask)], perfect_hash->slot_mask);
+	if (StringEqual(perfect_hash->slot_keys[slot], key)) {
+		return (const char*)perfect_hash->slot_values + slot * perfect_hash->value_size;
+	}
+	return NULL;
+}
+
+void DestroyPerfectHash(PerfectHash* perfect_hash)
+{
+	if (perfect_hash->slot_keys != NULL) {
+		free(perfect_hash->slot_keys);
+	}
+	if (perfect_hash->displacements != NULL) {
+		free(perfect_hash->displacements);
+	}
+	if (perfect_hash->uses_fallback) {
+		DestroyTable(&perfect_hash->fallback);
+	}
+	memset(perfect_hash, 0, sizeof(*perfect_hash));
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "StringUtilities.h"
+#include "HashTable.h"
+
+/*
+	The percentage of slots that are occupied in the displacement table
+*/
+#define PERFECT_HASH_LOAD_FACTOR 80
+
+/*
+	The average number of keys that share a displacement value
+*/
+#define PERFECT_HASH_BUCKET_SIZE 4
+
+/*
+	How many displacement values are tried for a bucket before the slot count is doubled
+*/
+#define PERFECT_HASH_MAX_DISPLACEMENT_ATTEMPTS (1 << 16)
+
+/*
+	Above this key count the displacement search is not attempted and the keys go into a regular hash table
+*/
+#define PERFECT_HASH_MAX_KEYS (1 << 20)
+
+/*
+	A static set of string keys with a value each, built once. It uses the hash and displace scheme: the keys
+	are split into small buckets by their hash and for each bucket a displacement is searched such that all
+	its keys land in free slots. A lookup costs one hash of the key, one displacement load and one compare.
+	If the displacement search fails (or there are too many keys), a regular hash table is used instead.
+*/
+typedef struct {
+	// Element type is string. The slots that are not used have a size of -1
+	string* slot_keys;
+	// value_size bytes for each slot
+	void* slot_values;
+	// For each bucket, the displacement that places all of its keys without collisions
+	unsigned int* displacements;
+	size_t slot_mask;
+	size_t bucket_mask;
+	size_t value_size;
+
+	bool uses_fallback;
+	// Identifier is string, element has value_size bytes
+	HashTable fallback;
+} PerfectHash;
+
+/*
+	The keys must stay valid for the lifetime of the perfect hash, only the string descriptors are copied.
+	If the same key appears multiple times, the first one is kept
+*/
+PerfectHash CreatePerfectHash(const string* keys, const void* values, size_t count, size_t value_size);
+
+/*
+	Returns a pointer to the value of the key, else NULL if the key is not in the set
+*/
+const void* FindPerfectHash(const PerfectHash* perfect_hash, string key);
+
+void DestroyPerfectHash(PerfectHash* perfect_hash);
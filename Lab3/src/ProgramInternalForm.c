@@ -1,6 +1,7 @@
 #include "ProgramInternalForm.h"
 #include "StringUtilities.h"
 #include "ParsingRules.h"
+#include "LexerCache.h"
 #include <stdio.h>
 #include <string.h>
 #include <cassert>
@@ -16,15 +17,22 @@ ProgramInternalForm CreatePIF() {
 	pif.integer_constant_fa = CreateFiniteAutomata();
 	pif.identifier_fa = CreateFiniteAutomata();
 
-	bool success = ReadFiniteAutomataFile("FAIdentifier.in", &pif.identifier_fa);
-	assert(success);
-	success = ReadFiniteAutomataFile("FAInteger.in", &pif.integer_constant_fa);
-	assert(success);
+	memset(&pif.delimiters, 0, sizeof(pif.delimiters));
+	memset(&pif.classifier, 0, sizeof(pif.classifier));
+	memset(&pif.cache, 0, sizeof(pif.cache));
+	pif.has_static_tables = false;
 
 	return pif;
 }
 
 bool ReadTokenFile(ProgramInternalForm* pif, const char* path) {
+	if (!ReadFiniteAutomataFile(PIF_IDENTIFIER_FA_PATH, &pif->identifier_fa)) {
+		return false;
+	}
+	if (!ReadFiniteAutomataFile(PIF_INTEGER_CONSTANT_FA_PATH, &pif->integer_constant_fa)) {
+		return false;
+	}
+
 	string token_file = ReadFile(path);
 	if (token_file.size == 0) {
 		return false;
@@ -46,22 +54,79 @@ bool ReadTokenFile(ProgramInternalForm* pif, const char* path) {
 	third_line_parse_region = StringAdvance(third_line_parse_region, 1);
 	ParseTokensFromWhitespace(third_line_parse_region, &pif->reserved_words);
 	free(token_file.characters);
+
+	pif->delimiters = CreateDelimiterTrie(pif->operators, pif->separators);
+	return CreateTokenClassifier(
+		&pif->classifier, 
+		pif->reserved_words, 
+		pif->operators, 
+		pif->separators, 
+		&pif->identifier_fa, 
+		&pif->integer_constant_fa
+	);
+}
+
+bool ReadTokenFileCached(ProgramInternalForm* pif, const char* path, const char* cache_path) {
+	const char* input_paths[] = { path, PIF_IDENTIFIER_FA_PATH, PIF_INTEGER_CONSTANT_FA_PATH };
+	uint64_t input_hash;
+	bool has_input_hash = HashLexerInputs(input_paths, sizeof(input_paths) / sizeof(input_paths[0]), &input_hash);
+
+	if (has_input_hash && LoadLexerCache(pif, input_hash, cache_path)) {
+		// The trie and the keyword hash hold pointers, they are rebuilt from the cached token lists
+		pif->delimiters = CreateDelimiterTrie(pif->operators, pif->separators);
+		CreateTokenClassifierKeywords(&pif->classifier, pif->reserved_words);
+		return true;
+	}
+
+	if (!ReadTokenFile(pif, path)) {
+		return false;
+	}
+	if (has_input_hash) {
+		// Failing to write the cache only means that the next run parses the files again
+		WriteLexerCache(pif, input_hash, cache_path);
+	}
 	return true;
 }
 
 size_t FindReservedWord(const ProgramInternalForm* pif, string token) {
-	return FindStringInStream(pif->reserved_words, token);
+	return FindTokenClassifierKeyword(&pif->classifier, token);
+}
+
+// The trie answers with the longest delimiter that is a prefix of the token, it must span the whole token
+static size_t FindDelimiter(const ProgramInternalForm* pif, string token, DELIMITER_KIND kind) {
+	DELIMITER_KIND match_kind;
+	size_t delimiter_index;
+	size_t match_size = MatchDelimiter(&pif->delimiters, token, &match_kind, &delimiter_index);
+	if (match_size == token.size && match_kind == kind) {
+		return delimiter_index;
+	}
+	return -1;
 }
 
 size_t FindOperator(const ProgramInternalForm* pif, string token) {
-	return FindStringInStream(pif->operators, token);
+	return FindDelimiter(pif, token, DELIMITER_OPERATOR);
 }
 
 size_t FindSeparator(const ProgramInternalForm* pif, string token) {
-	return FindStringInStream(pif->separators, token);
+	return FindDelimiter(pif, token, DELIMITER_SEPARATOR);
 }
 
 void DestroyPIF(ProgramInternalForm* pif) {
+	ReleaseLexerCache(pif);
+	if (pif->has_static_tables) {
+		// Only a fallback keyword table was built when loading
+		if (pif->classifier.keywords.uses_fallback) {
+			DestroyPerfectHash(&pif->classifier.keywords);
+		}
+		memset(&pif->reserved_words, 0, sizeof(pif->reserved_words));
+		memset(&pif->operators, 0, sizeof(pif->operators));
+		memset(&pif->separators, 0, sizeof(pif->separators));
+		memset(&pif->delimiters, 0, sizeof(pif->delimiters));
+		memset(&pif->classifier, 0, sizeof(pif->classifier));
+		memset(&pif->identifier_fa.compiled, 0, sizeof(pif->identifier_fa.compiled));
+		memset(&pif->integer_constant_fa.compiled, 0, sizeof(pif->integer_constant_fa.compiled));
+	}
+
 	DeallocateStrings(pif->reserved_words);
 	DeallocateStrings(pif->operators);
 	DeallocateStrings(pif->separators);
@@ -71,6 +136,11 @@ void DestroyPIF(ProgramInternalForm* pif) {
 	FreeStream(pif->separators);
 	FreeStream(pif->token_order);
 
+	DestroyFiniteAutomata(&pif->identifier_fa);
+	DestroyFiniteAutomata(&pif->integer_constant_fa);
+	DestroyDelimiterTrie(&pif->delimiters);
+	DestroyTokenClassifier(&pif->classifier);
+
 	memset(pif, 0, sizeof(*pif));
 }
 
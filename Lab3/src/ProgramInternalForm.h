@@ -3,24 +3,12 @@
 #include <stdbool.h>
 #include "StringUtilities.h"
 #include "FiniteAutomata.h"
+#include "TokenClassifier.h"
+#include "FileMapping.h"
 
-typedef enum {
-	TOKEN_IDENTIFIER,
-	TOKEN_INT_CONSTANT,
-	TOKEN_FLOAT_CONSTANT,
-	TOKEN_BOOL_CONSTANT,
-	TOKEN_STRING_CONSTANT,
-	TOKEN_RESERVED,
-	TOKEN_OPERATOR,
-	TOKEN_SEPARATOR
-} TOKEN_CLASS;
-
-typedef struct {
-	TOKEN_CLASS token_class;
-	// The entry index for tokens of class reserved word, operator or separator
-	// Is the index inside the array
-	size_t entry_index;
-} Token;
+// The automata files that ReadTokenFile loads next to the token file
+#define PIF_IDENTIFIER_FA_PATH "FAIdentifier.in"
+#define PIF_INTEGER_CONSTANT_FA_PATH "FAInteger.in"
 
 typedef struct {
 	// Element type is string
@@ -31,22 +19,40 @@ typedef struct {
 	ResizableStream separators;
 	// Element type is Token
 	ResizableStream token_order;
+	// Built by ReadTokenFile from the operators and the separators
+	DelimiterTrie delimiters;
 
 	FiniteAutomata identifier_fa;
 	FiniteAutomata integer_constant_fa;
+
+	// Built by ReadTokenFile from the token lists and the automatas
+	TokenClassifier classifier;
+
+	// Set when the lexer was loaded by ReadTokenFileCached from a cache file. The token lists,
+	// the classifier and the compiled automatas point into this mapping
+	MappedFile cache;
+	// Set by LoadGeneratedLexer. The token lists, the lookup tables, the classifier and the compiled
+	// automatas are the static tables of the generated lexer source and they are never freed
+	bool has_static_tables;
 } ProgramInternalForm;
 
 ProgramInternalForm CreatePIF();
 
+// Reads the token file and the identifier and integer constant automata files
 bool ReadTokenFile(ProgramInternalForm* pif, const char* path);
 
+// The same as ReadTokenFile, but the lexer is loaded from the cache file if it was built from the same input files.
+// Else the input files are parsed and the cache is written for the next run
+bool ReadTokenFileCached(ProgramInternalForm* pif, const char* path, const char* cache_path);
+
 // Returns -1 if it doesn't find it
 size_t FindReservedWord(const ProgramInternalForm* pif, string token);
 
-// Returns -1 if it doesn't find it
+// Returns -1 if it doesn't find it. Looked up in the delimiter trie
 size_t FindOperator(const ProgramInternalForm* pif, string token);
 
-// Returns -1 if it doesn't find it
+// Returns -1 if it doesn't find it. Looked up in the delimiter trie, a string that is an operator as well
+// is found only by FindOperator
 size_t FindSeparator(const ProgramInternalForm* pif, string token);
 
 void DestroyPIF(ProgramInternalForm* pif);
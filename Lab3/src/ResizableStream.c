@@ -92,7 +92,8 @@ void Resize(ResizableStream* stream, size_t new_capacity) {
 void Reserve(ResizableStream* stream, size_t element_count)
 {
 	if (stream->size + element_count > stream->capacity) {
-		Resize(stream, ResizeCapacity(stream->capacity));
+		// A single growth step can still be too small for many elements
+		Resize(stream, max(ResizeCapacity(stream->capacity), stream->size + element_count));
 	}
 }
 
@@ -2,107 +2,122 @@
 #include "ParsingRules.h"
 #include <stdio.h>
 
+#ifdef LEXER_STATIC_TABLES
+#include "GeneratedLexer.h"
+// The classifier tables are compiled in, the pif classifier is not consulted
+#define SCAN_CLASSIFY_TOKEN(pif, token, result) GeneratedClassifyToken(token, result)
+#else
+#define SCAN_CLASSIFY_TOKEN(pif, token, result) ClassifyToken(&(pif)->classifier, token, result)
+#endif
+
+// The token is printed with a precision such that very long tokens do not overflow the message
+#define SCAN_ERROR_TOKEN_PRECISION 128
+
+ScannerOptions DefaultScannerOptions()
+{
+	ScannerOptions options;
+	options.input_mode = SOURCE_READER_MAPPED;
+	options.batch_symbol_lookup = false;
+	return options;
+}
+
+/*
+	The error for a token that the symbol table could not add
+*/
+static string SymbolTableError(string token, size_t line_index)
+{
+	char temp_memory[256];
+	sprintf(temp_memory, "Could not add %.*s on line %zu to the symbol table", (int)min(token.size, SCAN_ERROR_TOKEN_PRECISION), token.characters, line_index + 1);
+	return StringMallocCopyFromPointer(temp_memory);
+}
+
+/*
+	Gives their entries to the tokens of a line that were left for the symbol table, the ones from first_token to the
+	end of the pif. The existing entries come from a single batched lookup, the new tokens are then added in their
+	order of appearance, such that a token that appears twice on the line is added only once.
+	Returns the first token that the symbol table could not add, NULL if there is none
+*/
+static const string* ResolveLineSymbols(ProgramInternalForm* pif, SymbolTable* symbol_table, size_t first_token, ResizableStream line_symbols, ResizableStream* symbol_entries)
+{
+	symbol_entries->size = 0;
+	Reserve(symbol_entries, line_symbols.size);
+	size_t* entries = symbol_entries->buffer;
+	GetSymbolTableEntries(symbol_table, line_symbols.buffer, line_symbols.size, entries);
+
+	size_t symbol_index = 0;
+	for (size_t index = first_token; index < pif->token_order.size; index++) {
+		Token* token = GetElement(pif->token_order, index);
+		if (token->entry_index == -1) {
+			const string* symbol = GetElement(line_symbols, symbol_index);
+			token->entry_index = entries[symbol_index] != -1 ? entries[symbol_index] : AddOrGetSymbolTableEntry(symbol_table, *symbol);
+			if (token->entry_index == -1) {
+				return symbol;
+			}
+			symbol_index++;
+		}
+	}
+	return NULL;
+}
+
 string ScanSourceFile(ProgramInternalForm* pif, SymbolTable* symbol_table, const char* source_file)
 {
-	string source_file_content = ReadFile(source_file);
-	if (source_file_content.size == 0) {
+	return ScanSourceFileWithOptions(pif, symbol_table, source_file, DefaultScannerOptions());
+}
+
+string ScanSourceFileWithOptions(ProgramInternalForm* pif, SymbolTable* symbol_table, const char* source_file, ScannerOptions options)
+{
+	// Only a line at a time is needed, the file is never copied as a whole into a heap buffer
+	SourceReader reader;
+	if (!CreateSourceReader(&reader, source_file, options.input_mode)) {
 		return StringFromLiteral("Could not open source file");
 	}
 
-	ResizableStream lines = CreateStream(16, sizeof(string));
-	ParseTokensFromLines(source_file_content, &lines);
+#define DEALLOCATE FreeStream(line_tokens); FreeStream(line_symbols); FreeStream(symbol_entries); DestroySourceReader(&reader);
 
-	for (size_t index = 0; index < lines.size; index++) {
-		ResizableStream line_tokens = CreateStream(16, sizeof(string));
-		const string* current_line = GetElement(lines, index);
-		ParseTokensWithSeparators(*current_line, pif->separators, pif->operators, &line_tokens, true);
+	ResizableStream line_tokens = CreateStream(16, sizeof(string));
+	// Only used by the batched lookup
+	ResizableStream line_symbols = CreateStream(0, sizeof(string));
+	ResizableStream symbol_entries = CreateStream(0, sizeof(size_t));
+	string current_line;
+	for (size_t index = 0; SourceReaderNextLine(&reader, &current_line); index++) {
+		// The token streams are reused for every line
+		line_tokens.size = 0;
+		line_symbols.size = 0;
+		size_t line_first_token = pif->token_order.size;
+		ParseTokensWithSeparators(current_line, &pif->delimiters, &line_tokens, true);
 
 		for (size_t subindex = 0; subindex < line_tokens.size; subindex++) {
 			const string* current_token = GetElement(line_tokens, subindex);
 
 			Token token;
-			token.entry_index = -1;
-			size_t reserved_word_index = FindReservedWord(pif, *current_token);
-			if (reserved_word_index != -1) {
-				token.token_class = TOKEN_RESERVED;
-				token.entry_index = reserved_word_index;
-			}
+			if (!SCAN_CLASSIFY_TOKEN(pif, *current_token, &token)) {
+				// Tokens with foreign characters are reported differently from malformed identifiers
+				const char* error_kind = IsTokenValid(*current_token) ? "identifier" : "token";
 
-			if (token.entry_index == -1) {
-				size_t operator_index = FindOperator(pif, *current_token);
-				if (operator_index != -1) {
-					token.token_class = TOKEN_OPERATOR;
-					token.entry_index = operator_index;
-				}
-			}
+				char temp_memory[256];
+				temp_memory[0] = '\0';
+				sprintf(temp_memory, "Invalid %s %.*s on line %zu", error_kind, (int)min(current_token->size, SCAN_ERROR_TOKEN_PRECISION), current_token->characters, index + 1);
 
-			if (token.entry_index == -1) {
-				size_t separator_index = FindSeparator(pif, *current_token);
-				if (separator_index != -1) {
-					token.token_class = TOKEN_SEPARATOR;
-					token.entry_index = separator_index;
+				// The tokens before the error are in the symbol table, like without the batched lookup
+				if (options.batch_symbol_lookup) {
+					ResolveLineSymbols(pif, symbol_table, line_first_token, line_symbols, &symbol_entries);
 				}
+				DEALLOCATE;
+				return StringMallocCopyFromPointer(temp_memory);
 			}
 
+			// Reserved words, operators and separators already have their index, the rest go into the symbol table
 			if (token.entry_index == -1) {
-				// Check if it is a string constant first since it has special \" characters
-				bool is_string_constant = IsStringConstant(*current_token);
-				if (is_string_constant) {
-					token.token_class = TOKEN_STRING_CONSTANT;
-					token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
+				if (options.batch_symbol_lookup) {
+					// The entry is filled in once the whole line is classified
+					Add(&line_symbols, current_token);
 				}
 				else {
-					if (!IsTokenValid(*current_token)) {
-						char null_terminated_token[256];
-						memcpy(null_terminated_token, current_token->characters, sizeof(char) * current_token->size);
-						null_terminated_token[current_token->size] = '\0';
-						
-						char temp_memory[256];
-						temp_memory[0] = '\0';
-						sprintf(temp_memory, "Invalid token %s on line %zu", null_terminated_token, index + 1);
-
-						free(source_file_content.characters);
-						return StringMallocCopyFromPointer(temp_memory);
-					}
-
-					bool is_int_constant = FiniteAutomataVerifySequence(&pif->integer_constant_fa, *current_token);
-					//bool is_int_constant = IsIntConstant(*current_token);
-					if (is_int_constant) {
-						token.token_class = TOKEN_INT_CONSTANT;
-						token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
-					}
-					else {
-						bool is_float_constant = IsFloatConstant(*current_token);
-						if (is_float_constant) {
-							token.token_class = TOKEN_FLOAT_CONSTANT;
-							token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
-						}
-						else {
-							bool is_bool_constant = IsBoolConstant(*current_token);
-							if (is_bool_constant) {
-								token.token_class = TOKEN_BOOL_CONSTANT;
-								token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
-							}
-							else {
-								//bool is_valid_identifier = IsValidIdentifier(*current_token);
-								bool is_valid_identifier = FiniteAutomataVerifySequence(&pif->identifier_fa, *current_token);
-								if (is_valid_identifier) {
-									token.token_class = TOKEN_IDENTIFIER;
-									token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
-								}
-								else {
-									char null_terminated_token[256];
-									memcpy(null_terminated_token, current_token->characters, sizeof(char) * current_token->size);
-									null_terminated_token[current_token->size] = '\0';
-
-									char temp_memory[256];
-									temp_memory[0] = '\0';
-									sprintf(temp_memory, "Invalid identifier %s on line %zu", null_terminated_token, index + 1);
-									free(source_file_content.characters);
-									return StringMallocCopyFromPointer(temp_memory);
-								}
-							}
-						}
+					token.entry_index = AddOrGetSymbolTableEntry(symbol_table, *current_token);
+					if (token.entry_index == -1) {
+						string error_string = SymbolTableError(*current_token, index);
+						DEALLOCATE;
+						return error_string;
 					}
 				}
 			}
@@ -110,11 +125,17 @@ string ScanSourceFile(ProgramInternalForm* pif, SymbolTable* symbol_table, const
 			Add(&pif->token_order, &token);
 		}
 
-		FreeStream(line_tokens);
+		if (line_symbols.size > 0) {
+			const string* failed_symbol = ResolveLineSymbols(pif, symbol_table, line_first_token, line_symbols, &symbol_entries);
+			if (failed_symbol != NULL) {
+				string error_string = SymbolTableError(*failed_symbol, index);
+				DEALLOCATE;
+				return error_string;
+			}
+		}
 	}
 
-	DeallocateStrings(lines);
-	FreeStream(lines);
-	free(source_file_content.characters);
+	DEALLOCATE;
 	return InvalidString();
+#undef DEALLOCATE
 }
@@ -1,6 +1,20 @@
 #pragma once
 #include "ProgramInternalForm.h"
 #include "SymbolTable.h"
+#include "SourceReader.h"
+
+typedef struct {
+	// How the source file is brought into memory
+	SOURCE_READER_MODE input_mode;
+	// The identifiers and constants of a line are looked up in the symbol table together, with a batched search
+	// that overlaps the cache misses of a big table. The entries are the same as with one lookup at a time
+	bool batch_symbol_lookup;
+} ScannerOptions;
+
+ScannerOptions DefaultScannerOptions();
 
 // Returns an error string if an error has occured, else an empty string
-string ScanSourceFile(ProgramInternalForm* pif, SymbolTable* symbol_table, const char* source_file);
\ No newline at end of file
+string ScanSourceFile(ProgramInternalForm* pif, SymbolTable* symbol_table, const char* source_file);
+
+// The same as ScanSourceFile, but with explicit options
+string ScanSourceFileWithOptions(ProgramInternalForm* pif, SymbolTable* symbol_table, const char* source_file, ScannerOptions options);
@@ -0,0 +1,100 @@
+#include "SourceReader.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool CreateSourceReader(SourceReader* reader, const char* path, SOURCE_READER_MODE mode)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->mode = mode;
+
+	if (mode == SOURCE_READER_MAPPED) {
+		if (MapFile(path, &reader->mapped_file)) {
+			reader->remaining = reader->mapped_file.contents;
+			return true;
+		}
+		// A single view cannot cover a file bigger than the address space (any file of several GB in a 32 bit build),
+		// it is read in chunks instead. A file that cannot be opened or is empty fails below as well
+		reader->mode = SOURCE_READER_STREAMED;
+	}
+
+	// Binary mode such that the offsets inside the chunk match the file. The \r is removed per line
+	reader->file = fopen(path, "rb");
+	if (reader->file == NULL) {
+		return false;
+	}
+
+	reader->chunk_capacity = SOURCE_READER_CHUNK_SIZE;
+	reader->chunk = malloc(sizeof(char) * reader->chunk_capacity);
+	reader->remaining = (string){ reader->chunk, fread(reader->chunk, sizeof(char), reader->chunk_capacity, reader->file) };
+	if (reader->remaining.size == 0) {
+		DestroySourceReader(reader);
+		return false;
+	}
+	return true;
+}
+
+/*
+	Moves the unconsumed bytes to the start of the chunk and fills the rest of it from the file. If the unconsumed
+	bytes already fill the chunk (a line longer than the chunk) the chunk is doubled first
+*/
+static void RefillSourceReader(SourceReader* reader) {
+	if (reader->remaining.size == reader->chunk_capacity) {
+		reader->chunk_capacity *= 2;
+		char* new_chunk = malloc(sizeof(char) * reader->chunk_capacity);
+		memcpy(new_chunk, reader->remaining.characters, sizeof(char) * reader->remaining.size);
+		free(reader->chunk);
+		reader->chunk = new_chunk;
+	}
+	else {
+		memmove(reader->chunk, reader->remaining.characters, sizeof(char) * reader->remaining.size);
+	}
+
+	size_t read_count = fread(reader->chunk + reader->remaining.size, sizeof(char), reader->chunk_capacity - reader->remaining.size, reader->file);
+	if (read_count == 0) {
+		reader->end_of_file = true;
+	}
+	reader->remaining = (string){ reader->chunk, reader->remaining.size + read_count };
+}
+
+bool SourceReaderNextLine(SourceReader* reader, string* line)
+{
+	// The bytes before this offset in remaining are known not to contain a line terminator
+	size_t searched_size = 0;
+	while (true) {
+		const char* new_line = memchr(reader->remaining.characters + searched_size, '\n', reader->remaining.size - searched_size);
+		if (new_line != NULL) {
+			size_t line_size = new_line - reader->remaining.characters;
+			*line = StringRemoveEndingChar((string){ reader->remaining.characters, line_size }, '\r');
+			reader->remaining = StringAdvance(reader->remaining, line_size + 1);
+			return true;
+		}
+
+		if (reader->mode == SOURCE_READER_MAPPED || reader->end_of_file) {
+			if (reader->remaining.size > 0) {
+				*line = StringRemoveEndingChar(reader->remaining, '\r');
+				reader->remaining = StringAdvance(reader->remaining, reader->remaining.size);
+				return true;
+			}
+			return false;
+		}
+
+		searched_size = reader->remaining.size;
+		RefillSourceReader(reader);
+	}
+}
+
+void DestroySourceReader(SourceReader* reader)
+{
+	if (reader->mode == SOURCE_READER_MAPPED) {
+		UnmapFile(&reader->mapped_file);
+	}
+	else {
+		if (reader->file != NULL) {
+			fclose(reader->file);
+		}
+		if (reader->chunk != NULL) {
+			free(reader->chunk);
+		}
+	}
+	memset(reader, 0, sizeof(*reader));
+}
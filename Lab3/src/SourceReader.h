@@ -0,0 +1,53 @@
+#pragma once
+#include <stdio.h>
+#include <stdbool.h>
+#include "StringUtilities.h"
+#include "FileMapping.h"
+
+/*
+	The initial byte size of the chunk used by the streamed mode. The chunk is doubled only when a single
+	line does not fit into it
+*/
+#define SOURCE_READER_CHUNK_SIZE (64 * 1024)
+
+typedef enum {
+	// The whole file is mapped into memory and the lines are views into the mapping. If the file cannot
+	// be mapped, for example because it does not fit into the address space, it is streamed instead
+	SOURCE_READER_MAPPED,
+	// The file is read in fixed size chunks. A line that crosses the chunk boundary is carried
+	// over to the start of the chunk before the next read
+	SOURCE_READER_STREAMED
+} SOURCE_READER_MODE;
+
+typedef struct {
+	SOURCE_READER_MODE mode;
+	// The part of the input that was not handed out yet. It points either into the mapping
+	// or into the chunk
+	string remaining;
+
+	// Used by the mapped mode
+	MappedFile mapped_file;
+
+	// Used by the streamed mode
+	FILE* file;
+	char* chunk;
+	size_t chunk_capacity;
+	bool end_of_file;
+} SourceReader;
+
+/*
+	Opens the source file in the given mode, the mode of the reader is streamed if the mapping failed.
+	Returns false if the file could not be opened or it is empty.
+*/
+bool CreateSourceReader(SourceReader* reader, const char* path, SOURCE_READER_MODE mode);
+
+/*
+	Retrieves the next line without the line terminator (both \n and \r\n are accepted). The line is valid
+	only until the next call. Returns false when there are no more lines.
+*/
+bool SourceReaderNextLine(SourceReader* reader, string* line);
+
+/*
+	Releases the mapping or the chunk and closes the file.
+*/
+void DestroySourceReader(SourceReader* reader);
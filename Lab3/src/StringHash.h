@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+	64 bit string hashes, all of them spread the identifiers over the low bits as well as over the high ones
+*/
+
+typedef enum {
+	// A byte at a time, the simplest one
+	STRING_HASH_FNV1A,
+	// 8 bytes at a time with 128 bit multiplications, in the style of wyhash
+	STRING_HASH_WY,
+	// The CRC32C instruction of SSE4.2 (a table when it is not available), 8 bytes at a time, followed by a finalizer
+	STRING_HASH_CRC32C,
+	STRING_HASH_COUNT
+} STRING_HASH;
+
+typedef uint64_t (*StringHashFunction)(const char* characters, size_t size);
+
+uint64_t StringHashFNV1a(const char* characters, size_t size);
+
+uint64_t StringHashWy(const char* characters, size_t size);
+
+uint64_t StringHashCRC32C(const char* characters, size_t size);
+
+StringHashFunction GetStringHashFunction(STRING_HASH hash);
+
+const char* GetStringHashName(STRING_HASH hash);
@@ -0,0 +1,163 @@
+#include "StringHashBenchmark.h"
+#include "StringHash.h"
+#include "SymbolTable.h"
+#include "Scanning.h"
+#include "HashTable.h"
+#include "HashTableProbe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int BenchmarkTokenCompare(const void* first, const void* second) {
+	return StringEqual(*(const string*)first, *(const string*)second);
+}
+
+static size_t BenchmarkHashFNV1a(const void* identifier) {
+	const string* token = identifier;
+	return (size_t)StringHashFNV1a(token->characters, token->size);
+}
+
+static size_t BenchmarkHashWy(const void* identifier) {
+	const string* token = identifier;
+	return (size_t)StringHashWy(token->characters, token->size);
+}
+
+static size_t BenchmarkHashCRC32C(const void* identifier) {
+	const string* token = identifier;
+	return (size_t)StringHashCRC32C(token->characters, token->size);
+}
+
+// The table takes the hash through a function of the identifier alone, so every hash has its own wrapper
+static const HashTableHashFunction BENCHMARK_HASH_FUNCTIONS[STRING_HASH_COUNT] = {
+	BenchmarkHashFNV1a,
+	BenchmarkHashWy,
+	BenchmarkHashCRC32C
+};
+
+static int CompareHashValues(const void* first, const void* second) {
+	uint64_t first_hash = *(const uint64_t*)first;
+	uint64_t second_hash = *(const uint64_t*)second;
+	return first_hash < second_hash ? -1 : (first_hash > second_hash ? 1 : 0);
+}
+
+static int CollectTokenIterate(void* element, void* identifier, void* extra_data) {
+	// The short tokens point into the slots of the symbol table, it is not changed while they are used
+	string* tokens = extra_data;
+	tokens[*(const size_t*)element] = SymbolKeyString(identifier);
+	return 0;
+}
+
+static double ElapsedMilliseconds(clock_t start) {
+	return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+// The number of tokens that have the same full hash as another token
+static size_t CountHashCollisions(StringHashFunction hash_function, const string* tokens, size_t token_count) {
+	uint64_t* hashes = malloc(sizeof(uint64_t) * max(token_count, 1));
+	for (size_t index = 0; index < token_count; index++) {
+		hashes[index] = hash_function(tokens[index].characters, tokens[index].size);
+	}
+	qsort(hashes, token_count, sizeof(uint64_t), CompareHashValues);
+
+	size_t collisions = 0;
+	for (size_t index = 1; index < token_count; index++) {
+		collisions += hashes[index] == hashes[index - 1];
+	}
+	free(hashes);
+	return collisions;
+}
+
+static void BenchmarkStringHash(STRING_HASH hash, const string* tokens, size_t token_count, const string* occurrences, size_t occurrence_count) {
+	HashTable table = CreateTable(0, sizeof(size_t), sizeof(string), HashTableMapPowerOfTwo, BENCHMARK_HASH_FUNCTIONS[hash], BenchmarkTokenCompare);
+
+	// The table is built again for every round, the last one is kept for the histogram
+	size_t insertion_rounds = max(STRING_HASH_BENCHMARK_INSERTIONS / max(token_count, 1), 1);
+	clock_t start = clock();
+	for (size_t round = 0; round < insertion_rounds; round++) {
+		DestroyTable(&table);
+		table = CreateTable(0, sizeof(size_t), sizeof(string), HashTableMapPowerOfTwo, BENCHMARK_HASH_FUNCTIONS[hash], BenchmarkTokenCompare);
+		for (size_t index = 0; index < token_count; index++) {
+			int inserted;
+			FindOrInsertTable(&table, &index, tokens + index, &inserted);
+		}
+	}
+	double insertion_time = ElapsedMilliseconds(start);
+
+	size_t lookup_rounds = max(STRING_HASH_BENCHMARK_LOOKUPS / max(occurrence_count, 1), 1);
+	size_t found = 0;
+	start = clock();
+	for (size_t round = 0; round < lookup_rounds; round++) {
+		for (size_t index = 0; index < occurrence_count; index++) {
+			found += FindTable(&table, occurrences + index) != -1;
+		}
+	}
+	double lookup_time = ElapsedMilliseconds(start);
+
+	size_t histogram[HASH_TABLE_MAX_DISTANCE];
+	GetTableProbeHistogram(&table, histogram);
+	size_t probe_total = 0;
+	size_t longest_probe = 0;
+	for (size_t index = 0; index < HASH_TABLE_MAX_DISTANCE; index++) {
+		probe_total += histogram[index] * (index + 1);
+		if (histogram[index] > 0) {
+			longest_probe = index + 1;
+		}
+	}
+
+	printf("%s\n", GetStringHashName(hash));
+	printf("\tinsertion: %.2f ns per token, lookup: %.2f ns per token (%zu found)\n",
+		insertion_time * 1000000.0 / (double)max(insertion_rounds * token_count, 1),
+		lookup_time * 1000000.0 / (double)max(lookup_rounds * occurrence_count, 1),
+		found / lookup_rounds
+	);
+	printf("\tcapacity %zu, average probe %.3f, longest probe %zu, full hash collisions %zu\n",
+		table.capacity, (double)probe_total / (double)max(token_count, 1), longest_probe,
+		CountHashCollisions(GetStringHashFunction(hash), tokens, token_count)
+	);
+	printf("\tprobe lengths:");
+	for (size_t index = 0; index < longest_probe; index++) {
+		printf(" %zu", histogram[index]);
+	}
+	printf("\n");
+
+	DestroyTable(&table);
+}
+
+bool PrintStringHashBenchmark(ProgramInternalForm* pif, const char* source_file)
+{
+	SymbolTable symbol_table = CreateSymbolTable(0);
+	size_t first_token = pif->token_order.size;
+	string error_string = ScanSourceFile(pif, &symbol_table, source_file);
+	if (error_string.size > 0) {
+		printf("Lexical error: %s", error_string.characters);
+		pif->token_order.size = first_token;
+		DeleteSymbolTable(&symbol_table);
+		return false;
+	}
+
+	// The distinct tokens are indexed by their entries, the occurrences follow the order of the file
+	string* tokens = malloc(sizeof(string) * max(symbol_table.entry_count, 1));
+	IterateTable(&symbol_table.storage, CollectTokenIterate, tokens);
+	size_t token_count = symbol_table.entry_count;
+
+	string* occurrences = malloc(sizeof(string) * max(pif->token_order.size - first_token, 1));
+	size_t occurrence_count = 0;
+	for (size_t index = first_token; index < pif->token_order.size; index++) {
+		const Token* token = GetElement(pif->token_order, index);
+		if (token->token_class < TOKEN_RESERVED) {
+			occurrences[occurrence_count++] = tokens[token->entry_index];
+		}
+	}
+	pif->token_order.size = first_token;
+
+	printf("%zu distinct tokens, %zu occurrences\n", token_count, occurrence_count);
+	for (size_t hash = 0; hash < STRING_HASH_COUNT; hash++) {
+		BenchmarkStringHash((STRING_HASH)hash, tokens, token_count, occurrences, occurrence_count);
+	}
+
+	free(occurrences);
+	free(tokens);
+	DeleteSymbolTable(&symbol_table);
+	return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "ProgramInternalForm.h"
+
+// How many insertions and lookups every hash is timed over, the tokens of the file are repeated to reach them
+#define STRING_HASH_BENCHMARK_INSERTIONS (1 << 20)
+#define STRING_HASH_BENCHMARK_LOOKUPS (1 << 22)
+
+/*
+	Scans the source file and measures every hash of StringHash.h on its identifiers and constants. For each hash it
+	prints the time to insert the distinct tokens into a table and to look up every occurrence, the probe length
+	histogram of the table and how many tokens share their full 64 bit hash with another one. The lexer of the pif
+	must already be loaded, the tokens of the file are not kept in it. Returns false if the file cannot be scanned
+*/
+bool PrintStringHashBenchmark(ProgramInternalForm* pif, const char* source_file);
@@ -14,12 +14,24 @@ string ReadFile(const char* path)
 {
 	FILE* file = fopen(path, "rt");
 	if (file) {
-		const size_t ALLOCATION_SIZE = 1024;
-		char* string_allocation = malloc(sizeof(char) * ALLOCATION_SIZE);
-		size_t characters_read = fread(string_allocation, sizeof(char), ALLOCATION_SIZE, file);
-		if (characters_read == ALLOCATION_SIZE) {
-			characters_read--;
+		// The text mode translation can only shrink the file, so the byte size is an upper bound
+		fseek(file, 0, SEEK_END);
+		long file_size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		size_t capacity = file_size > 0 ? (size_t)file_size + 1 : 1024;
+		char* string_allocation = malloc(sizeof(char) * capacity);
+		size_t characters_read = 0;
+		while (true) {
+			characters_read += fread(string_allocation + characters_read, sizeof(char), capacity - characters_read - 1, file);
+			if (characters_read < capacity - 1 || feof(file)) {
+				break;
+			}
+			capacity *= 2;
+			string_allocation = realloc(string_allocation, sizeof(char) * capacity);
 		}
+		fclose(file);
+
 		string_allocation[characters_read] = '\0';
 		return (string){ string_allocation, characters_read };
 	}
@@ -87,6 +99,50 @@ string StringMallocCopyFromPointer(const char* characters)
 	return StringMallocCopy((string) { characters, strlen(characters) });
 }
 
+StringArena CreateStringArena()
+{
+	StringArena arena;
+	arena.blocks = CreateStream(0, sizeof(char*));
+	arena.next_character = NULL;
+	arena.remaining_size = 0;
+	return arena;
+}
+
+string StringArenaCopy(StringArena* arena, string _string)
+{
+	size_t allocation_size = _string.size + 1;
+	char* allocation;
+	if (allocation_size > STRING_ARENA_BLOCK_SIZE / 4) {
+		// A long string would waste the rest of a block, it gets its own and the current block stays in use
+		allocation = malloc(sizeof(char) * allocation_size);
+		Add(&arena->blocks, &allocation);
+	}
+	else {
+		if (allocation_size > arena->remaining_size) {
+			char* block = malloc(sizeof(char) * STRING_ARENA_BLOCK_SIZE);
+			Add(&arena->blocks, &block);
+			arena->next_character = block;
+			arena->remaining_size = STRING_ARENA_BLOCK_SIZE;
+		}
+		allocation = arena->next_character;
+		arena->next_character += allocation_size;
+		arena->remaining_size -= allocation_size;
+	}
+
+	memcpy(allocation, _string.characters, sizeof(char) * _string.size);
+	allocation[_string.size] = '\0';
+	return (string) { allocation, _string.size };
+}
+
+void DestroyStringArena(StringArena* arena)
+{
+	for (size_t index = 0; index < arena->blocks.size; index++) {
+		free(*(char**)GetElement(arena->blocks, index));
+	}
+	FreeStream(arena->blocks);
+	memset(arena, 0, sizeof(*arena));
+}
+
 string InvalidString() {
 	return (string) { NULL, 0 };
 }
@@ -212,10 +268,108 @@ string ParseTokenStringUntilMatched(string parse_range, string token_string) {
 	return token_string;
 }
 
+static size_t AddDelimiterTrieNode(DelimiterTrie* trie) {
+	DelimiterTrieNode node;
+	node.children = CreateStream(0, sizeof(DelimiterTrieEdge));
+	node.kind = DELIMITER_NONE;
+	node.delimiter_index = -1;
+	Add(&trie->nodes, &node);
+	return trie->nodes.size - 1;
+}
+
+static size_t FindDelimiterTrieChild(const DelimiterTrie* trie, size_t node, unsigned char character) {
+	if (node == 0) {
+		return trie->root_children[character];
+	}
+
+	const DelimiterTrieNode* trie_node = GetElement(trie->nodes, node);
+	for (size_t index = 0; index < trie_node->children.size; index++) {
+		const DelimiterTrieEdge* edge = GetElement(trie_node->children, index);
+		if (edge->character == character) {
+			return edge->node;
+		}
+	}
+	return 0;
+}
+
+static void AddDelimiterTrieStrings(DelimiterTrie* trie, ResizableStream delimiters, DELIMITER_KIND kind) {
+	for (size_t index = 0; index < delimiters.size; index++) {
+		const string* delimiter = GetElement(delimiters, index);
+		size_t node = 0;
+		for (size_t character_index = 0; character_index < delimiter->size; character_index++) {
+			unsigned char character = delimiter->characters[character_index];
+			size_t child = FindDelimiterTrieChild(trie, node, character);
+			if (child == 0) {
+				child = AddDelimiterTrieNode(trie);
+				if (node == 0) {
+					trie->root_children[character] = child;
+				}
+				else {
+					DelimiterTrieNode* trie_node = GetElement(trie->nodes, node);
+					DelimiterTrieEdge edge = { character, child };
+					Add(&trie_node->children, &edge);
+				}
+			}
+			node = child;
+		}
+
+		// The first one that was added wins
+		DelimiterTrieNode* trie_node = GetElement(trie->nodes, node);
+		if (node != 0 && trie_node->kind == DELIMITER_NONE) {
+			trie_node->kind = kind;
+			trie_node->delimiter_index = index;
+		}
+	}
+}
+
+DelimiterTrie CreateDelimiterTrie(ResizableStream operators, ResizableStream separators)
+{
+	DelimiterTrie trie;
+	trie.nodes = CreateStream(operators.size + separators.size + 1, sizeof(DelimiterTrieNode));
+	memset(trie.root_children, 0, sizeof(trie.root_children));
+	AddDelimiterTrieNode(&trie);
+
+	AddDelimiterTrieStrings(&trie, operators, DELIMITER_OPERATOR);
+	AddDelimiterTrieStrings(&trie, separators, DELIMITER_SEPARATOR);
+	return trie;
+}
+
+void DestroyDelimiterTrie(DelimiterTrie* trie)
+{
+	for (size_t index = 0; index < trie->nodes.size; index++) {
+		DelimiterTrieNode* node = GetElement(trie->nodes, index);
+		FreeStream(node->children);
+	}
+	FreeStream(trie->nodes);
+	memset(trie, 0, sizeof(*trie));
+}
+
+size_t MatchDelimiter(const DelimiterTrie* trie, string characters, DELIMITER_KIND* kind, size_t* delimiter_index)
+{
+	*kind = DELIMITER_NONE;
+	size_t match_size = 0;
+
+	size_t node = 0;
+	for (size_t index = 0; index < characters.size; index++) {
+		node = FindDelimiterTrieChild(trie, node, characters.characters[index]);
+		if (node == 0) {
+			break;
+		}
+
+		// Keep walking after a match, a longer delimiter can still follow
+		const DelimiterTrieNode* trie_node = GetElement(trie->nodes, node);
+		if (trie_node->kind != DELIMITER_NONE) {
+			*kind = trie_node->kind;
+			*delimiter_index = trie_node->delimiter_index;
+			match_size = index + 1;
+		}
+	}
+	return match_size;
+}
+
 void ParseTokensWithSeparators(
 	string parse_range, 
-	ResizableStream separators, 
-	ResizableStream operators, 
+	const DelimiterTrie* delimiters, 
 	ResizableStream* tokens, 
 	bool skip_whitespace
 ) {
@@ -252,72 +406,56 @@ void ParseTokensWithSeparators(
 			}
 		}
 
-		size_t operator_index = 0; 
-		for (; operator_index < operators.size; operator_index++) {
-			const string* operator_ = GetElement(operators, operator_index);
-			if (parse_range.size - index >= operator_->size) {
-				string current_string = (string){ parse_range.characters + index, operator_->size };
-				if (memcmp(parse_range.characters + index, operator_->characters, sizeof(char) * operator_->size) == 0) {
-					bool is_token_string = false;
-					if (index != starting_token_index) {
-						string token_string = (string){ parse_range.characters + starting_token_index, index - starting_token_index };
-						string string_token = ParseTokenStringUntilMatched(parse_range, token_string);
-						if (token_string.size == string_token.size) {
-							Add(tokens, &token_string);
-						}
-						else {
-							Add(tokens, &string_token);
-							size_t new_index = string_token.characters + string_token.size - parse_range.characters;
-							if (new_index > index) {
-								index = new_index;
-								is_token_string = true;
-								starting_token_index = index + 1;
-							}
-						}
-					}
-
-					if (!is_token_string) {
-						Add(tokens, &current_string);
-						index += operator_->size - 1;
+		DELIMITER_KIND delimiter_kind;
+		size_t delimiter_index;
+		size_t delimiter_size = MatchDelimiter(delimiters, StringAdvance(parse_range, index), &delimiter_kind, &delimiter_index);
+		string current_string = (string){ parse_range.characters + index, delimiter_size };
+
+		if (delimiter_kind == DELIMITER_OPERATOR) {
+			bool is_token_string = false;
+			if (index != starting_token_index) {
+				string token_string = (string){ parse_range.characters + starting_token_index, index - starting_token_index };
+				string string_token = ParseTokenStringUntilMatched(parse_range, token_string);
+				if (token_string.size == string_token.size) {
+					Add(tokens, &token_string);
+				}
+				else {
+					Add(tokens, &string_token);
+					size_t new_index = string_token.characters + string_token.size - parse_range.characters;
+					if (new_index > index) {
+						index = new_index;
+						is_token_string = true;
 						starting_token_index = index + 1;
 					}
-					break;
 				}
 			}
-		}
-		
-		size_t separator_index = 0;
-		if (operator_index == operators.size) {
-			for (; separator_index < separators.size; separator_index++) {
-				const string* separator = GetElement(separators, separator_index);
-				if (parse_range.size - index >= separator->size) {
-					string current_string = (string){ parse_range.characters + index, separator->size };
-					if (memcmp(parse_range.characters + index, separator->characters, sizeof(char) * separator->size) == 0) {
-						bool is_token_string = false;
-						if (index != starting_token_index) {
-							string token_string = (string){ parse_range.characters + starting_token_index, index - starting_token_index };
-							string string_token = ParseTokenStringUntilMatched(parse_range, token_string);
-							if (token_string.size == string_token.size) {
-								Add(tokens, &token_string);
-							}
-							else {
-								Add(tokens, &string_token);
-								size_t new_index = string_token.characters + string_token.size - parse_range.characters;
-								if (new_index) {
-									index = new_index;
-									is_token_string = true;
-									starting_token_index = index + 1;
-								}
-							}
-						}
 
-						Add(tokens, &current_string);
-						index += separator->size - 1;
+			if (!is_token_string) {
+				Add(tokens, &current_string);
+				index += delimiter_size - 1;
+				starting_token_index = index + 1;
+			}
+		}
+		else if (delimiter_kind == DELIMITER_SEPARATOR) {
+			if (index != starting_token_index) {
+				string token_string = (string){ parse_range.characters + starting_token_index, index - starting_token_index };
+				string string_token = ParseTokenStringUntilMatched(parse_range, token_string);
+				if (token_string.size == string_token.size) {
+					Add(tokens, &token_string);
+				}
+				else {
+					Add(tokens, &string_token);
+					size_t new_index = string_token.characters + string_token.size - parse_range.characters;
+					if (new_index) {
+						index = new_index;
 						starting_token_index = index + 1;
-						break;
 					}
 				}
 			}
+
+			Add(tokens, &current_string);
+			index += delimiter_size - 1;
+			starting_token_index = index + 1;
 		}
 	}
 
@@ -356,6 +494,21 @@ void ParseTokensByCharacter(string parse_range, char character, ResizableStream*
 	}
 }
 
+string ParseNextTokenByCharacter(string* parse_range, char character)
+{
+	size_t index = 0;
+	while (index < parse_range->size && parse_range->characters[index] == character) {
+		index++;
+	}
+	size_t token_start = index;
+	while (index < parse_range->size && parse_range->characters[index] != character) {
+		index++;
+	}
+	string token = { parse_range->characters + token_start, index - token_start };
+	*parse_range = StringAdvance(*parse_range, index);
+	return token;
+}
+
 bool ParseStringsFromFormat(string parse_range, string format_string, ResizableStream* strings)
 {
 	size_t parse_range_start = 0;
@@ -413,4 +566,5 @@ bool StringStartsWith(string characters, string substring)
 		characters.size = substring.size;
 		return StringEqual(characters, substring);
 	}
+	return false;
 }
@@ -10,8 +10,52 @@ typedef struct {
 	size_t size;
 } string;
 
+typedef enum {
+	DELIMITER_NONE,
+	DELIMITER_OPERATOR,
+	DELIMITER_SEPARATOR
+} DELIMITER_KIND;
+
+typedef struct {
+	unsigned char character;
+	size_t node;
+} DelimiterTrieEdge;
+
+typedef struct {
+	// Element type is DelimiterTrieEdge
+	ResizableStream children;
+	// The kind of the delimiter that ends at this node, DELIMITER_NONE if it is only a prefix
+	DELIMITER_KIND kind;
+	// Index inside the operators or separators array
+	size_t delimiter_index;
+} DelimiterTrieNode;
+
+// A trie over the operators and the separators. The children of the root are kept in a table indexed
+// by the first byte, the deeper nodes have only a few children and keep them in a list
+typedef struct {
+	// Element type is DelimiterTrieNode, the root is at index 0
+	ResizableStream nodes;
+	// The child of the root for each byte value, 0 if no delimiter starts with that byte
+	size_t root_children[256];
+} DelimiterTrie;
+
+// The byte size of the blocks of a StringArena. A string (with its terminator) longer than a quarter of a block
+// gets an allocation of its own, such that it does not waste the rest of the current block
+#define STRING_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Keeps null terminated copies of strings next to each other in large blocks. The copies are never freed
+// one by one, the whole arena is released at once
+typedef struct {
+	// Element type is char*, every block that was allocated
+	ResizableStream blocks;
+	// The unused part of the last regular block
+	char* next_character;
+	size_t remaining_size;
+} StringArena;
+
 string StringFromLiteral(const char* literal);
 
+// Reads the whole file into a null terminated heap allocation
 string ReadFile(const char* path);
 
 string FindCharacter(string characters, char character);
@@ -28,6 +72,14 @@ string StringMallocCopy(string _string);
 
 string StringMallocCopyFromPointer(const char* characters);
 
+StringArena CreateStringArena();
+
+// Returns a null terminated copy of the string that lives until the arena is destroyed
+string StringArenaCopy(StringArena* arena, string _string);
+
+// Frees every copy that the arena handed out
+void DestroyStringArena(StringArena* arena);
+
 string InvalidString();
 
 // Returns the index in the stream if it finds it, else -1 if it doesn't exist
@@ -62,10 +114,20 @@ void ParseTokensFromWhitespace(string parse_range, ResizableStream* tokens);
 // Fills in all the positions of all occurences of the token
 void FindAllOccurences(string parse_range, string token, ResizableStream* tokens);
 
+// Operators and separators must have as element type string
+// If the same string is both an operator and a separator, it is matched as an operator
+DelimiterTrie CreateDelimiterTrie(ResizableStream operators, ResizableStream separators);
+
+void DestroyDelimiterTrie(DelimiterTrie* trie);
+
+// Returns the size of the longest operator or separator that is a prefix of characters, 0 if there is none
+size_t MatchDelimiter(const DelimiterTrie* trie, string characters, DELIMITER_KIND* kind, size_t* delimiter_index);
+
+// The operators and separators are matched with the longest match rule, the order in which they
+// were given does not matter
 void ParseTokensWithSeparators(
 	string parse_range, 
-	ResizableStream separators, 
-	ResizableStream operators, 
+	const DelimiterTrie* delimiters, 
 	ResizableStream* tokens, 
 	bool skip_whitespace
 );
@@ -73,6 +135,10 @@ void ParseTokensWithSeparators(
 // Tokens must have as element type string
 void ParseTokensByCharacter(string parse_range, char character, ResizableStream* tokens);
 
+// Returns the next token separated by the character and advances the parse range past it. Nothing is allocated,
+// the token points into the parse range. Empty tokens are skipped, an empty string is returned at the end of the range
+string ParseNextTokenByCharacter(string* parse_range, char character);
+
 // strings must have as element type string
 bool ParseStringsFromFormat(string parse_range, string format_string, ResizableStream* strings);
 
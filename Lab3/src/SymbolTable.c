@@ -1,88 +1,103 @@
 #include "SymbolTable.h"
+#include "TypedHashTable.h"
+#include "HashTableProbe.h"
 #include <string.h>
 #include <malloc.h>
 #include <stdio.h>
 
-static size_t ENTRY_COUNTER = 0;
-
-static int SymbolTableIdentifierCompare(const void* first, const void* second) {
-	return StringEqual(*(string*)first, *(string*)second);
+static inline int SymbolTableIdentifierCompare(const SymbolKey* first, const SymbolKey* second) {
+	return SymbolKeyEqual(first, second);
 }
 
-static size_t SymbolTableMapFunction(size_t index, size_t capacity) {
-	return index % capacity;
+static inline size_t SymbolTableMapFunction(size_t index, size_t capacity) {
+	// The hashes of StringHash.h spread the tokens over the low bits too, a mask is enough
+	return index & (capacity - 1);
 }
 
-static size_t SymbolTableHashFunction(const void* identifier) {
-	const string* string_identifier = (const string*)identifier;
-	size_t hash = 0;
-	for (size_t index = 0; index < string_identifier->size; index++) {
-		hash += string_identifier->characters[index] * index;
-	}
-	return hash;
+static inline size_t SymbolTableHashFunction(const SymbolKey* key) {
+	string token = SymbolKeyString(key);
+	return (size_t)SYMBOL_TABLE_HASH_FUNCTION(token.characters, token.size);
 }
 
-static size_t SymbolTableGrowFunction(size_t capacity)
-{
-	return capacity == 0 ? 16 : capacity << 1;
+HASH_TABLE_TYPED(SymbolStorage, SymbolKey, size_t, SymbolTableHashFunction, SymbolTableIdentifierCompare, SymbolTableMapFunction)
+
+size_t SymbolTableHash(string token) {
+	return (size_t)SYMBOL_TABLE_HASH_FUNCTION(token.characters, token.size);
 }
 
 SymbolTable CreateSymbolTable(size_t initial_capacity) {
 	SymbolTable result;
-	result.storage = CreateTable(
-		initial_capacity,
-		sizeof(size_t),
-		sizeof(string),
-		SymbolTableMapFunction,
-		SymbolTableHashFunction,
-		SymbolTableIdentifierCompare
-	);
+	result.storage = CreateSymbolStorage(HashTablePowerOfTwoCapacity(initial_capacity));
+	result.entry_count = 0;
+	result.tokens = CreateStringArena();
+	SetTableIncrementalResize(&result.storage, SYMBOL_TABLE_RESIZE_STEP);
 	return result;
 }
 
 size_t AddOrGetSymbolTableEntry(SymbolTable* table, string token) {
-	size_t existing_index = GetSymbolTableEntry(table, token);
-	if (existing_index != -1) {
-		return existing_index;
+	size_t entry_index = table->entry_count;
+	SymbolKey key = CreateSymbolKey(token);
+	int inserted;
+	size_t index = FindOrInsertSymbolStorage(&table->storage, &entry_index, &key, &inserted);
+	if (index == -1) {
+		return -1;
 	}
-
-	size_t entry_index = ENTRY_COUNTER;
-
-	if (table->storage.capacity == table->storage.size) {
-		GrowTable(&table->storage, SymbolTableGrowFunction);
+	if (!inserted) {
+		return *(const size_t*)GetTablePtr(&table->storage, index);
 	}
 
-	char* token_allocation = (char*)malloc((token.size + 1) * sizeof(char));
-	memcpy(token_allocation, token.characters, sizeof(char) * token.size);
-	token_allocation[token.size] = '\0';
-	token.characters = token_allocation;
-
-	AddTable(&table->storage, &entry_index , &token);
-	ENTRY_COUNTER++;
+	if (IsSymbolKeyLong(&key)) {
+		// The table was given a view into the caller's token, it must own a copy
+		SymbolKey* stored_key = GetTableIdentifierPtr(&table->storage, index);
+		stored_key->long_key.characters = StringArenaCopy(&table->tokens, token).characters;
+	}
+	table->entry_count++;
 
 	return entry_index;
 }
 
 size_t GetSymbolTableEntry(const SymbolTable* table, string token) {
-	const size_t* entry_ptr = FindTablePtr(&table->storage, &token);
+	SymbolKey key = CreateSymbolKey(token);
+	const size_t* entry_ptr = FindSymbolStoragePtr(&table->storage, &key);
 	return entry_ptr == NULL ? -1 : *entry_ptr;
 }
 
+void GetSymbolTableEntries(const SymbolTable* table, const string* tokens, size_t count, size_t* entry_indices) {
+	// The keys of the tokens are built a batch at a time
+	SymbolKey keys[HASH_TABLE_BATCH_SIZE];
+	for (size_t batch_start = 0; batch_start < count; batch_start += HASH_TABLE_BATCH_SIZE) {
+		size_t batch_count = min(count - batch_start, HASH_TABLE_BATCH_SIZE);
+		for (size_t index = 0; index < batch_count; index++) {
+			keys[index] = CreateSymbolKey(tokens[batch_start + index]);
+		}
+		FindSymbolStorageBatch(&table->storage, keys, batch_count, entry_indices + batch_start);
+	}
+
+	// The table indices are replaced in place by the entries that they point to
+	for (size_t index = 0; index < count; index++) {
+		if (entry_indices[index] != -1) {
+			entry_indices[index] = *SymbolStorageElementPtr(&table->storage, entry_indices[index]);
+		}
+	}
+}
+
 void RemoveSymbolTableEntry(SymbolTable* table, string token) {
-	RemoveTable(&table->storage, &token);
+	SymbolKey key = CreateSymbolKey(token);
+	RemoveTable(&table->storage, &key);
 }
 
 void DeleteSymbolTable(SymbolTable* table) {
 	DestroyTable(&table->storage);
+	DestroyStringArena(&table->tokens);
 	memset(table, 0, sizeof(*table));
 }
 
 int WriteToFileIterate(void* element, void* identifier, void* extra_data) {
 	FILE* file = (FILE*)extra_data;
-	const string* key = (const string*)identifier;
+	string key = SymbolKeyString((const SymbolKey*)identifier);
 	const size_t* entry_index = (const size_t*)element;
 
-	fprintf(file, "%s | %zu\n", key->characters, *entry_index);
+	fprintf(file, "%s | %zu\n", key.characters, *entry_index);
 	return 0;
 }
 
@@ -1,19 +1,98 @@
 #pragma once
 #include "HashTable.h"
 #include "StringUtilities.h"
+#include "StringHash.h"
+
+// The hash of the tokens, one of the functions of StringHash.h. The tables inline it, so it is chosen when compiling
+#ifndef SYMBOL_TABLE_HASH_FUNCTION
+#define SYMBOL_TABLE_HASH_FUNCTION StringHashWy
+#endif
+
+// How many old slots every insertion moves while the storage grows, such that a token never waits for
+// the rehash of the whole table
+#define SYMBOL_TABLE_RESIZE_STEP 16
+
+// Tokens of at most this many characters are stored inside their key
+#define SYMBOL_KEY_INLINE_SIZE 15
+// The last byte of a key that points to its characters
+#define SYMBOL_KEY_LONG_TAG 0xFF
+
+/*
+	The identifier of the symbol tables, 16 bytes like a string. A token of at most SYMBOL_KEY_INLINE_SIZE characters
+	is kept inside the key, padded with zeros, and the last byte holds SYMBOL_KEY_INLINE_SIZE minus its size, which
+	is also the null terminator of the longest ones. A longer token is pointed to and the last byte is
+	SYMBOL_KEY_LONG_TAG. Comparing the short keys, which are most of the tokens, does not leave the table
+*/
+typedef union {
+	char inline_characters[SYMBOL_KEY_INLINE_SIZE + 1];
+	struct {
+		char* characters;
+		uint32_t size;
+	} long_key;
+} SymbolKey;
+
+static inline bool IsSymbolKeyLong(const SymbolKey* key) {
+	return (unsigned char)key->inline_characters[SYMBOL_KEY_INLINE_SIZE] == SYMBOL_KEY_LONG_TAG;
+}
+
+// The key of a long token points to the characters of the token, they are not copied
+static inline SymbolKey CreateSymbolKey(string token) {
+	SymbolKey key;
+	memset(&key, 0, sizeof(key));
+	if (token.size <= SYMBOL_KEY_INLINE_SIZE) {
+		memcpy(key.inline_characters, token.characters, sizeof(char) * token.size);
+		key.inline_characters[SYMBOL_KEY_INLINE_SIZE] = (char)(SYMBOL_KEY_INLINE_SIZE - token.size);
+	}
+	else {
+		key.long_key.characters = token.characters;
+		key.long_key.size = (uint32_t)token.size;
+		key.inline_characters[SYMBOL_KEY_INLINE_SIZE] = (char)SYMBOL_KEY_LONG_TAG;
+	}
+	return key;
+}
+
+// The characters of a short key are the ones inside it, they are null terminated in both cases
+static inline string SymbolKeyString(const SymbolKey* key) {
+	if (IsSymbolKeyLong(key)) {
+		return (string) { key->long_key.characters, key->long_key.size };
+	}
+	return (string) { (char*)key->inline_characters, SYMBOL_KEY_INLINE_SIZE - key->inline_characters[SYMBOL_KEY_INLINE_SIZE] };
+}
+
+static inline bool SymbolKeyEqual(const SymbolKey* first, const SymbolKey* second) {
+	if (!IsSymbolKeyLong(first) || !IsSymbolKeyLong(second)) {
+		// Two short keys are equal exactly when all their bytes are, and the last byte tells apart a short key from a long one
+		return memcmp(first, second, sizeof(SymbolKey)) == 0;
+	}
+	return first->long_key.size == second->long_key.size &&
+		memcmp(first->long_key.characters, second->long_key.characters, sizeof(char) * first->long_key.size) == 0;
+}
 
 typedef struct {
 	HashTable storage;
+	// The entry index of the next new token, every table counts its entries from 0
+	size_t entry_count;
+	// The copies of the long tokens that the table owns
+	StringArena tokens;
 } SymbolTable;
 
+// The capacity is rounded up to a power of two
 SymbolTable CreateSymbolTable(size_t initial_capacity);
 
-// If the token already exists, returns its index, else it adds it and generates a new entry index
+// The hash of the tokens in the symbol tables
+size_t SymbolTableHash(string token);
+
+// If the token already exists, returns its index, else it adds it and generates a new entry index.
+// Returns -1 if the token could not be added, when more than HASH_TABLE_MAX_DISTANCE tokens have its hash
 size_t AddOrGetSymbolTableEntry(SymbolTable* table, string token);
 
 // Retrieve the entry index for that token
 size_t GetSymbolTableEntry(const SymbolTable* table, string token);
 
+// Retrieve the entry indices of count tokens with one batched lookup, -1 for the tokens that are not in the table
+void GetSymbolTableEntries(const SymbolTable* table, const string* tokens, size_t count, size_t* entry_indices);
+
+// The copy of the token stays in the arena of the table until the table is deleted
 void RemoveSymbolTableEntry(SymbolTable* table, string token);
 
 void DeleteSymbolTable(SymbolTable* table);
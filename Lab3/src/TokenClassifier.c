@@ -0,0 +1,222 @@
+#include "TokenClassifier.h"
+#include "ParsingRules.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	The characters that can appear in a token which is not a string constant (the same ones IsTokenValid accepts)
+*/
+static bool IsTokenAlphabetChar(char character) {
+	return IsUppercaseChar(character) || IsLowercaseChar(character) || IsDigitChar(character) || character == '.';
+}
+
+static size_t AddClassifierLabel(TokenClassifier* classifier, TOKEN_CLASS token_class, size_t entry_index) {
+	Token token;
+	token.token_class = token_class;
+	token.entry_index = entry_index;
+	Add(&classifier->labels, &token);
+	return classifier->labels.size - 1;
+}
+
+static void SetNFAStateLabel(NFA* nfa, size_t state, size_t label) {
+	NFAState* nfa_state = GetElement(nfa->states, state);
+	nfa_state->accept_label = min(nfa_state->accept_label, label);
+}
+
+/*
+	Adds the word as a path starting from the root. The words that share a prefix share the states as well,
+	so the states reachable from the root form a trie
+*/
+static void AddClassifierWord(NFA* nfa, size_t root, string word, size_t label) {
+	size_t state = root;
+	for (size_t index = 0; index < word.size; index++) {
+		unsigned char terminal = word.characters[index];
+		const NFAState* nfa_state = GetElement(nfa->states, state);
+
+		size_t next_state = -1;
+		for (size_t transition_index = 0; transition_index < nfa_state->transitions.size; transition_index++) {
+			const NFATransition* transition = GetElement(nfa_state->transitions, transition_index);
+			if (transition->first_terminal == terminal && transition->last_terminal == terminal) {
+				next_state = transition->target_state;
+				break;
+			}
+		}
+
+		if (next_state == -1) {
+			next_state = AddNFAState(nfa, DENSE_AUTOMATA_NO_LABEL);
+			AddNFATransition(nfa, state, terminal, terminal, next_state);
+		}
+		state = next_state;
+	}
+	SetNFAStateLabel(nfa, state, label);
+}
+
+static void AddClassifierWords(TokenClassifier* classifier, NFA* nfa, size_t root, ResizableStream words, TOKEN_CLASS token_class) {
+	for (size_t index = 0; index < words.size; index++) {
+		const string* word = GetElement(words, index);
+		AddClassifierWord(nfa, root, *word, AddClassifierLabel(classifier, token_class, index));
+	}
+}
+
+/*
+	A reserved word can be left to the keyword hash if the automata would otherwise classify it as a token
+	of the symbol table: the identifier automata accepts it and it is not an operator or a separator as well
+*/
+static bool IsKeywordOnlyWord(string word, ResizableStream operators, ResizableStream separators, FiniteAutomata* identifier_fa) {
+	for (size_t index = 0; index < word.size; index++) {
+		if (!IsTokenAlphabetChar(word.characters[index])) {
+			return false;
+		}
+	}
+	return FiniteAutomataVerifySequence(identifier_fa, word) && FindStringInStream(operators, word) == -1
+		&& FindStringInStream(separators, word) == -1;
+}
+
+static void AddClassifierReservedWords(
+	TokenClassifier* classifier,
+	NFA* nfa,
+	size_t root,
+	ResizableStream reserved_words,
+	ResizableStream operators,
+	ResizableStream separators,
+	FiniteAutomata* identifier_fa
+) {
+	for (size_t index = 0; index < reserved_words.size; index++) {
+		const string* word = GetElement(reserved_words, index);
+		size_t label = AddClassifierLabel(classifier, TOKEN_RESERVED, index);
+		if (!IsKeywordOnlyWord(*word, operators, separators, identifier_fa)) {
+			AddClassifierWord(nfa, root, *word, label);
+		}
+	}
+}
+
+void CreateTokenClassifierKeywords(TokenClassifier* classifier, ResizableStream reserved_words)
+{
+	ResizableStream values = CreateStream(reserved_words.size, sizeof(Token));
+	for (size_t index = 0; index < reserved_words.size; index++) {
+		Token token;
+		token.token_class = TOKEN_RESERVED;
+		token.entry_index = index;
+		Add(&values, &token);
+	}
+	classifier->keywords = CreatePerfectHash(reserved_words.buffer, values.buffer, reserved_words.size, sizeof(Token));
+	FreeStream(values);
+}
+
+size_t FindTokenClassifierKeyword(const TokenClassifier* classifier, string token)
+{
+	const Token* keyword = FindPerfectHash(&classifier->keywords, token);
+	return keyword != NULL ? keyword->entry_index : -1;
+}
+
+/*
+	Copies the automata into the combined one and makes its initial state one of the initial states.
+	The transitions on characters that the token alphabet rejects can never be taken, so they are dropped
+*/
+static void AddClassifierAutomata(NFA* nfa, const FiniteAutomata* finite_automata, size_t label) {
+	if (finite_automata->initial_state == -1) {
+		return;
+	}
+
+	bool allowed_terminals[DENSE_AUTOMATA_ALPHABET_SIZE];
+	for (size_t terminal = 0; terminal < DENSE_AUTOMATA_ALPHABET_SIZE; terminal++) {
+		allowed_terminals[terminal] = IsTokenAlphabetChar((char)terminal);
+	}
+
+	size_t state_offset = AddFiniteAutomataToNFA(nfa, finite_automata, label, allowed_terminals);
+	AddNFAInitialState(nfa, state_offset + finite_automata->initial_state);
+}
+
+bool CreateTokenClassifier(
+	TokenClassifier* classifier,
+	ResizableStream reserved_words,
+	ResizableStream operators,
+	ResizableStream separators,
+	FiniteAutomata* identifier_fa,
+	const FiniteAutomata* integer_constant_fa
+)
+{
+	classifier->lazy = NULL;
+	CreateTokenClassifierKeywords(classifier, reserved_words);
+	classifier->labels = CreateStream(reserved_words.size + operators.size + separators.size + 8, sizeof(Token));
+	NFA nfa = CreateNFA();
+
+	// The labels are created in the priority order, the smallest one wins
+	size_t word_root = AddNFAState(&nfa, DENSE_AUTOMATA_NO_LABEL);
+	AddNFAInitialState(&nfa, word_root);
+	AddClassifierReservedWords(classifier, &nfa, word_root, reserved_words, operators, separators, identifier_fa);
+	AddClassifierWords(classifier, &nfa, word_root, operators, TOKEN_OPERATOR);
+	AddClassifierWords(classifier, &nfa, word_root, separators, TOKEN_SEPARATOR);
+
+	// String constants: a quote, anything and a closing quote
+	size_t string_label = AddClassifierLabel(classifier, TOKEN_STRING_CONSTANT, -1);
+	size_t string_start = AddNFAState(&nfa, DENSE_AUTOMATA_NO_LABEL);
+	size_t string_body = AddNFAState(&nfa, DENSE_AUTOMATA_NO_LABEL);
+	size_t string_end = AddNFAState(&nfa, string_label);
+	AddNFAInitialState(&nfa, string_start);
+	AddNFATransition(&nfa, string_start, '\"', '\"', string_body);
+	AddNFATransition(&nfa, string_body, 0, DENSE_AUTOMATA_ALPHABET_SIZE - 1, string_body);
+	AddNFATransition(&nfa, string_body, '\"', '\"', string_end);
+
+	AddClassifierAutomata(&nfa, integer_constant_fa, AddClassifierLabel(classifier, TOKEN_INT_CONSTANT, -1));
+
+	// Float constants: digits and dots
+	size_t float_label = AddClassifierLabel(classifier, TOKEN_FLOAT_CONSTANT, -1);
+	size_t float_start = AddNFAState(&nfa, DENSE_AUTOMATA_NO_LABEL);
+	size_t float_body = AddNFAState(&nfa, float_label);
+	AddNFAInitialState(&nfa, float_start);
+	AddNFATransition(&nfa, float_start, '0', '9', float_body);
+	AddNFATransition(&nfa, float_body, '0', '9', float_body);
+	AddNFATransition(&nfa, float_start, '.', '.', float_body);
+	AddNFATransition(&nfa, float_body, '.', '.', float_body);
+
+	size_t bool_label = AddClassifierLabel(classifier, TOKEN_BOOL_CONSTANT, -1);
+	AddClassifierWord(&nfa, word_root, StringFromLiteral("true"), bool_label);
+	AddClassifierWord(&nfa, word_root, StringFromLiteral("false"), bool_label);
+
+	AddClassifierAutomata(&nfa, identifier_fa, AddClassifierLabel(classifier, TOKEN_IDENTIFIER, -1));
+
+	DenseAutomata deterministic;
+	bool success = DeterminizeNFA(&nfa, TOKEN_CLASSIFIER_MAX_DENSE_STATES, &deterministic);
+	if (!success) {
+		memset(&classifier->automata, 0, sizeof(classifier->automata));
+		classifier->lazy = malloc(sizeof(LazyAutomata));
+		CreateLazyAutomata(&nfa, LAZY_AUTOMATA_DEFAULT_CACHE_SIZE, classifier->lazy);
+		DestroyNFA(&nfa);
+		return true;
+	}
+	DestroyNFA(&nfa);
+
+	MinimizeDenseAutomata(&deterministic, &classifier->automata);
+	DestroyDenseAutomata(&deterministic);
+	return true;
+}
+
+bool ClassifyToken(TokenClassifier* classifier, string token, Token* result)
+{
+	size_t label = classifier->lazy != NULL ? LazyAutomataRun(classifier->lazy, token) : DenseAutomataRun(&classifier->automata, token);
+	if (label == DENSE_AUTOMATA_NO_LABEL) {
+		return false;
+	}
+	*result = *(const Token*)GetElement(classifier->labels, label);
+	if (result->token_class < TOKEN_RESERVED) {
+		size_t keyword = FindTokenClassifierKeyword(classifier, token);
+		if (keyword != -1) {
+			result->token_class = TOKEN_RESERVED;
+			result->entry_index = keyword;
+		}
+	}
+	return true;
+}
+
+void DestroyTokenClassifier(TokenClassifier* classifier)
+{
+	DestroyDenseAutomata(&classifier->automata);
+	if (classifier->lazy != NULL) {
+		DestroyLazyAutomata(classifier->lazy);
+		free(classifier->lazy);
+	}
+	FreeStream(classifier->labels);
+	DestroyPerfectHash(&classifier->keywords);
+	memset(classifier, 0, sizeof(*classifier));
+}
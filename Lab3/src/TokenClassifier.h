@@ -0,0 +1,88 @@
+#pragma once
+#include <stdbool.h>
+#include "ResizableStream.h"
+#include "StringUtilities.h"
+#include "FiniteAutomata.h"
+#include "DenseAutomata.h"
+#include "LazyAutomata.h"
+#include "PerfectHash.h"
+
+/*
+	Above this many deterministic states the classifier builds its states lazily instead of up front
+*/
+#define TOKEN_CLASSIFIER_MAX_DENSE_STATES (1 << 16)
+
+typedef enum {
+	TOKEN_IDENTIFIER,
+	TOKEN_INT_CONSTANT,
+	TOKEN_FLOAT_CONSTANT,
+	TOKEN_BOOL_CONSTANT,
+	TOKEN_STRING_CONSTANT,
+	TOKEN_RESERVED,
+	TOKEN_OPERATOR,
+	TOKEN_SEPARATOR
+} TOKEN_CLASS;
+
+typedef struct {
+	TOKEN_CLASS token_class;
+	// The entry index for tokens of class reserved word, operator or separator
+	// Is the index inside the array
+	size_t entry_index;
+} Token;
+
+/*
+	A single deterministic automata that recognizes every token class at once. Its accepting states are labeled
+	with the class of the token in the same priority order that the scanner used to test them one after the other:
+	reserved words, operators, separators, string constants, integer constants, float constants, bool constants
+	and at last identifiers.
+	The reserved words that the identifier automata accepts are left out of the automata, else every one of them
+	adds its own path of states next to the identifier states. The automata classifies them as identifiers (or as
+	the constants they look like) and they are resolved through the keyword perfect hash instead, which is searched
+	only for the tokens that would go into the symbol table.
+	Classifying with the lazy automata fills in its state cache, a classifier must not be used from multiple threads
+	at the same time. Scanners that run in parallel need a pif each
+*/
+typedef struct {
+	DenseAutomata automata;
+	// Element type is Token, over all the reserved words. The keys point into the reserved word list
+	PerfectHash keywords;
+	// Not NULL if the deterministic automata was too big, then it is used instead of the dense one
+	LazyAutomata* lazy;
+	// Element type is Token, indexed by the accept label of the automata
+	ResizableStream labels;
+} TokenClassifier;
+
+/*
+	Builds the combined automata from the token lists (element type is string) and the identifier and integer
+	constant automatas. If the subset construction goes above TOKEN_CLASSIFIER_MAX_DENSE_STATES, the combined
+	automata is built lazily while classifying. The reserved words are verified with the identifier automata.
+	Returns false if the combined automata could not be built.
+*/
+bool CreateTokenClassifier(
+	TokenClassifier* classifier,
+	ResizableStream reserved_words,
+	ResizableStream operators,
+	ResizableStream separators,
+	FiniteAutomata* identifier_fa,
+	const FiniteAutomata* integer_constant_fa
+);
+
+/*
+	Builds the keyword hash of the classifier over the reserved words (element type is string), which must stay valid
+	while the classifier is used. CreateTokenClassifier calls it, a classifier loaded from a cache needs it again
+*/
+void CreateTokenClassifierKeywords(TokenClassifier* classifier, ResizableStream reserved_words);
+
+/*
+	Returns the entry of the reserved word, -1 if the token is not a reserved word
+*/
+size_t FindTokenClassifierKeyword(const TokenClassifier* classifier, string token);
+
+/*
+	Classifies the token in a single pass over its characters. Tokens of class reserved word, operator or separator
+	have the entry index filled in, for the others it is -1 since they go into the symbol table.
+	Returns false if the token does not belong to any class.
+*/
+bool ClassifyToken(TokenClassifier* classifier, string token, Token* result);
+
+void DestroyTokenClassifier(TokenClassifier* classifier);
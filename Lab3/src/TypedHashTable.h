@@ -0,0 +1,305 @@
+#pragma once
+#include "HashTable.h"
+#include "HashTableProbe.h"
+
+/*
+	The inline counterparts of the default functions of HashTable.h, for the typed tables
+*/
+static inline size_t TypedHashTableMapPowerOfTwo(size_t hash, size_t capacity) {
+	return hash & (capacity - 1);
+}
+
+static inline size_t TypedHashTableHashSizeT(const size_t* identifier) {
+	return *identifier;
+}
+
+static inline int TypedHashTableCompareSizeT(const size_t* first, const size_t* second) {
+	return *first == *second;
+}
+
+/*
+	Generates a hash table for a fixed identifier type and element type. The hash, compare and map functions are
+	called directly, such that the compiler can inline them, and the elements and identifiers are copied by
+	assignment instead of memcpy with the runtime sizes.
+		hash_function - size_t (const identifier_type* identifier)
+		compare_function - int (const identifier_type* first, const identifier_type* second)
+		map_function - size_t (size_t hash, size_t capacity)
+	For a name like Foo it generates:
+		HashTable CreateFoo(size_t capacity)
+		int AddFoo(HashTable* table, const element_type* element, const identifier_type* identifier)
+		size_t FindFoo(const HashTable* table, const identifier_type* identifier)
+		element_type* FindFooPtr(const HashTable* table, const identifier_type* identifier)
+		void FindFooBatch(const HashTable* table, const identifier_type* identifiers, size_t count, size_t* indices)
+		size_t FindOrInsertFoo(HashTable* table, const element_type* element, const identifier_type* identifier, int* inserted)
+		element_type* FindOrInsertFooPtr(...)
+	which behave like CreateTable, AddTable, FindTable, FindTablePtr, FindTableBatch, FindOrInsertTable and
+	FindOrInsertTablePtr, the failed insertions included.
+	The table is an ordinary HashTable with the same layout and it also receives function pointers to the given
+	functions, the rest of the functions (GrowTable, RemoveTable, IterateTable, DestroyTable...) work on it as usual,
+	the resize policy and the incremental resize included.
+	It is meant to be used inside a .c file, all the generated functions are static
+*/
+#define HASH_TABLE_TYPED(name, identifier_type, element_type, hash_function, compare_function, map_function) \
+	static inline size_t name##HashPointer(const void* identifier) { \
+		return hash_function((const identifier_type*)identifier); \
+	} \
+	\
+	static inline int name##ComparePointer(const void* first, const void* second) { \
+		return compare_function((const identifier_type*)first, (const identifier_type*)second); \
+	} \
+	\
+	static inline size_t name##MapPointer(size_t hash, size_t capacity) { \
+		return map_function(hash, capacity); \
+	} \
+	\
+	static inline HashTable Create##name(size_t capacity) { \
+		return CreateTable(capacity, sizeof(element_type), sizeof(identifier_type), name##MapPointer, name##HashPointer, name##ComparePointer); \
+	} \
+	\
+	static inline int name##InsertAt( \
+		HashTable* table, \
+		const element_type* element, \
+		const identifier_type* identifier, \
+		size_t key, \
+		size_t index, \
+		unsigned char distance, \
+		size_t* placed_index \
+	) { \
+		if (!HashTableInsertionFits(table->metadata, table->capacity + HASH_TABLE_MAX_DISTANCE, index, distance)) { \
+			return 0; \
+		} \
+		element_type* elements = (element_type*)table->buffer; \
+		identifier_type* identifiers = (identifier_type*)table->identifiers; \
+		element_type current_element = *element; \
+		identifier_type current_identifier = *identifier; \
+		size_t new_element_index = -1; \
+		\
+		while (1) { \
+			unsigned char element_distance = table->metadata[index]; \
+			while (element_distance > distance) { \
+				distance++; \
+				index++; \
+				element_distance = table->metadata[index]; \
+			} \
+			if (new_element_index == -1) { \
+				new_element_index = index; \
+			} \
+			\
+			if (element_distance == 0) { \
+				table->metadata[index] = distance; \
+				elements[index] = current_element; \
+				identifiers[index] = current_identifier; \
+				table->hashes[index] = key; \
+				table->size++; \
+				table->max_search_length = distance > table->max_search_length ? distance : table->max_search_length; \
+				break; \
+			} \
+			\
+			/* The richer slot is swapped with the carried entry, which keeps probing for an empty slot */ \
+			element_type swapped_element = elements[index]; \
+			identifier_type swapped_identifier = identifiers[index]; \
+			size_t swapped_key = table->hashes[index]; \
+			elements[index] = current_element; \
+			identifiers[index] = current_identifier; \
+			table->hashes[index] = key; \
+			table->metadata[index] = distance; \
+			table->max_search_length = distance > table->max_search_length ? distance : table->max_search_length; \
+			\
+			distance = element_distance + 1; \
+			current_element = swapped_element; \
+			current_identifier = swapped_identifier; \
+			key = swapped_key; \
+			table->max_search_length = distance > table->max_search_length ? distance : table->max_search_length; \
+			index++; \
+		} \
+		*placed_index = new_element_index; \
+		return 1; \
+	} \
+	\
+	/* The same policy as AddTable, the table grows until the element fits and once more if it is overloaded */ \
+	static inline int name##AddHashed(HashTable* table, const element_type* element, const identifier_type* identifier, size_t key) { \
+		int resized = 0; \
+		size_t placed_index; \
+		if (table->capacity == 0) { \
+			GrowTable(table, table->grow_function); \
+			resized = 1; \
+		} \
+		FinishTableResizeForKey(table, key); \
+		while (!name##InsertAt(table, element, identifier, key, map_function(key, table->capacity), 1, &placed_index)) { \
+			if (!GrowTableForKey(table, key)) { \
+				return -1; \
+			} \
+			resized = 1; \
+		} \
+		if (table->size * 100 > table->capacity * table->max_load_factor) { \
+			GrowTable(table, table->grow_function); \
+			resized = 1; \
+		} \
+		return resized; \
+	} \
+	\
+	static inline int Add##name(HashTable* table, const element_type* element, const identifier_type* identifier) { \
+		if (table->migration.buffer != NULL) { \
+			MigrateTableSlots(table, table->resize_step); \
+		} \
+		return name##AddHashed(table, element, identifier, hash_function(identifier)); \
+	} \
+	\
+	static inline size_t name##Probe(const HashTable* table, const identifier_type* identifier, size_t key, size_t* stop_index, size_t* stop_distance) { \
+		const identifier_type* identifiers = (const identifier_type*)table->identifiers; \
+		size_t index = map_function(key, table->capacity); \
+		size_t distance = 1; \
+		HASH_TABLE_TYPED_GROUP_PROBE(identifier_type, compare_function) \
+		\
+		for (; distance <= table->max_search_length; distance++) { \
+			unsigned char current_distance = table->metadata[index]; \
+			if (current_distance == distance) { \
+				if (table->hashes[index] == key && compare_function(identifier, identifiers + index)) { \
+					return index; \
+				} \
+			} \
+			else if (current_distance < distance) { \
+				break; \
+			} \
+			index++; \
+		} \
+		*stop_index = index; \
+		*stop_distance = distance; \
+		return -1; \
+	} \
+	\
+	static inline size_t Find##name(const HashTable* table, const identifier_type* identifier) { \
+		if (table->capacity == 0) { \
+			return -1; \
+		} \
+		size_t key = hash_function(identifier); \
+		size_t stop_index, stop_distance; \
+		size_t index = name##Probe(table, identifier, key, &stop_index, &stop_distance); \
+		if (index == -1 && table->migration.buffer != NULL) { \
+			index = FindTableUnmigrated(table, identifier, key); \
+		} \
+		return index; \
+	} \
+	\
+	/* The entries that an incremental resize did not move yet are past the extended capacity */ \
+	static inline element_type* name##ElementPtr(const HashTable* table, size_t index) { \
+		if (index < table->capacity + HASH_TABLE_MAX_DISTANCE) { \
+			return (element_type*)table->buffer + index; \
+		} \
+		return (element_type*)GetTablePtr(table, index); \
+	} \
+	\
+	static inline element_type* Find##name##Ptr(const HashTable* table, const identifier_type* identifier) { \
+		size_t index = Find##name(table, identifier); \
+		return index == -1 ? NULL : name##ElementPtr(table, index); \
+	} \
+	\
+	static inline void Find##name##Batch(const HashTable* table, const identifier_type* identifiers, size_t count, size_t* indices) { \
+		if (table->capacity == 0) { \
+			for (size_t index = 0; index < count; index++) { \
+				indices[index] = -1; \
+			} \
+			return; \
+		} \
+		size_t keys[HASH_TABLE_BATCH_SIZE]; \
+		for (size_t batch_start = 0; batch_start < count; batch_start += HASH_TABLE_BATCH_SIZE) { \
+			size_t batch_count = count - batch_start < HASH_TABLE_BATCH_SIZE ? count - batch_start : HASH_TABLE_BATCH_SIZE; \
+			const identifier_type* batch_identifiers = identifiers + batch_start; \
+			for (size_t index = 0; index < batch_count; index++) { \
+				keys[index] = hash_function(batch_identifiers + index); \
+				size_t home = map_function(keys[index], table->capacity); \
+				HashTablePrefetch(table->metadata + home); \
+				HashTablePrefetch(table->hashes + home); \
+				HashTablePrefetch((const identifier_type*)table->identifiers + home); \
+			} \
+			for (size_t index = 0; index < batch_count; index++) { \
+				size_t stop_index, stop_distance; \
+				size_t found_index = name##Probe(table, batch_identifiers + index, keys[index], &stop_index, &stop_distance); \
+				if (found_index == -1 && table->migration.buffer != NULL) { \
+					found_index = FindTableUnmigrated(table, batch_identifiers + index, keys[index]); \
+				} \
+				indices[batch_start + index] = found_index; \
+			} \
+		} \
+	} \
+	\
+	static inline size_t FindOrInsert##name( \
+		HashTable* table, \
+		const element_type* element, \
+		const identifier_type* identifier, \
+		int* inserted \
+	) { \
+		if (table->capacity == 0) { \
+			GrowTable(table, table->grow_function); \
+		} \
+		if (table->migration.buffer != NULL) { \
+			MigrateTableSlots(table, table->resize_step); \
+		} \
+		size_t key = hash_function(identifier); \
+		size_t stop_index, stop_distance; \
+		size_t index = name##Probe(table, identifier, key, &stop_index, &stop_distance); \
+		if (index == -1 && table->migration.buffer != NULL) { \
+			index = FindTableUnmigrated(table, identifier, key); \
+		} \
+		*inserted = index == -1; \
+		if (index != -1) { \
+			return index; \
+		} \
+		if (!FinishTableResizeForKey(table, key) && name##InsertAt(table, element, identifier, key, stop_index, (unsigned char)stop_distance, &index)) { \
+			if (table->size * 100 <= table->capacity * table->max_load_factor) { \
+				return index; \
+			} \
+			GrowTable(table, table->grow_function); \
+		} \
+		else if (name##AddHashed(table, element, identifier, key) == -1) { \
+			*inserted = 0; \
+			return -1; \
+		} \
+		/* With an incremental resize the new entry can be one of the old ones */ \
+		index = name##Probe(table, identifier, key, &stop_index, &stop_distance); \
+		if (index == -1) { \
+			index = FindTableUnmigrated(table, identifier, key); \
+		} \
+		return index; \
+	} \
+	\
+	static inline element_type* FindOrInsert##name##Ptr( \
+		HashTable* table, \
+		const element_type* element, \
+		const identifier_type* identifier, \
+		int* inserted \
+	) { \
+		/* The index comes first, the insertion can grow the table and move the buffer */ \
+		size_t index = FindOrInsert##name(table, element, identifier, inserted); \
+		return index != -1 ? name##ElementPtr(table, index) : NULL; \
+	}
+
+/*
+	The group probing part of the generated probe, the same as the one in FindTable
+*/
+#ifdef HASH_TABLE_PROBE_GROUP
+#define HASH_TABLE_TYPED_GROUP_PROBE(identifier_type, compare_function) \
+	size_t extended_capacity = table->capacity + HASH_TABLE_MAX_DISTANCE; \
+	while (distance <= table->max_search_length && index + HASH_TABLE_PROBE_GROUP <= extended_capacity) { \
+		uint32_t stop_mask; \
+		uint32_t match_mask = HashTableMatchDistanceGroup(table->metadata + index, (unsigned char)distance, &stop_mask); \
+		match_mask = HashTableLimitGroupMatches(match_mask, stop_mask, table->max_search_length - distance + 1); \
+		while (match_mask != 0) { \
+			size_t match_index = index + HashTableLowestMatch(match_mask); \
+			if (table->hashes[match_index] == key && compare_function(identifier, identifiers + match_index)) { \
+				return match_index; \
+			} \
+			match_mask &= match_mask - 1; \
+		} \
+		if (stop_mask != 0) { \
+			size_t stop_offset = HashTableLowestMatch(stop_mask); \
+			*stop_index = index + stop_offset; \
+			*stop_distance = distance + stop_offset; \
+			return -1; \
+		} \
+		distance += HASH_TABLE_PROBE_GROUP; \
+		index += HASH_TABLE_PROBE_GROUP; \
+	}
+#else
+#define HASH_TABLE_TYPED_GROUP_PROBE(identifier_type, compare_function)
+#endif
@@ -1,15 +1,47 @@
 #include <stdio.h>
+#include <string.h>
 #include "SymbolTable.h"
 #include "ProgramInternalForm.h"
 #include "Scanning.h"
 #include "FiniteAutomata.h"
+#include "LexerGenerator.h"
+#include "StringHashBenchmark.h"
+#ifdef LEXER_STATIC_TABLES
+#include "GeneratedLexer.h"
+#endif
 
-int main() {
+int main(int argc, char** argv) {
 	ProgramInternalForm pif = CreatePIF();
 	SymbolTable symbol_table = CreateSymbolTable(0);
 
-	ReadTokenFile(&pif, "token.in");
-	string error_string = ScanSourceFile(&pif, &symbol_table, "p2.txt");
+	// Lab3 --generate-lexer <output.c> writes the lexer as static tables for the LEXER_STATIC_TABLES builds
+	if (argc == 3 && strcmp(argv[1], "--generate-lexer") == 0) {
+		bool success = ReadTokenFile(&pif, "token.in") && GenerateLexerSource(&pif, argv[2]);
+		if (!success) {
+			printf("Failed to generate %s\n", argv[2]);
+			return 1;
+		}
+		printf("Generated %s\n", argv[2]);
+		return 0;
+	}
+
+#ifdef LEXER_STATIC_TABLES
+	LoadGeneratedLexer(&pif);
+#else
+	// Repeated runs map the compiled lexer instead of parsing the token and automata files
+	ReadTokenFileCached(&pif, "token.in", "token.cache");
+#endif
+	// Lab3 --hash-benchmark <source file> compares the string hashes on the identifiers and constants of the file
+	if (argc == 3 && strcmp(argv[1], "--hash-benchmark") == 0) {
+		return PrintStringHashBenchmark(&pif, argv[2]) ? 0 : 1;
+	}
+
+	// Lab3 --batch-symbol-lookup looks up the identifiers and constants of each line in the symbol table together
+	ScannerOptions options = DefaultScannerOptions();
+	if (argc == 2 && strcmp(argv[1], "--batch-symbol-lookup") == 0) {
+		options.batch_symbol_lookup = true;
+	}
+	string error_string = ScanSourceFileWithOptions(&pif, &symbol_table, "p2.txt", options);
 
 	if (error_string.size > 0) {
 		printf("Lexical error: %s", error_string.characters);